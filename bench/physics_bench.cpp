@@ -0,0 +1,184 @@
+#include <benchmark/benchmark.h>
+#include <array>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "../small/include/phy/vec2.h"
+#include "../small/include/phy/polygonrb.h"
+#include "../small/include/phy/collision.h"
+#include "../small/include/phy/integrator.h"
+#include "../small/include/phy/particlestore.h"
+#include "../small/include/phy/xpbd.h"
+
+// every case runs at 1k, 10k and 100k entities and reports entities per second
+#define ENTITY_COUNTS ->Arg(1000)->Arg(10000)->Arg(100000)
+
+constexpr float W = 1024;
+constexpr float H = 640;
+
+using Box = std::array<phy::vec2, 4>;
+
+// 20-40px boxes at random angles, b placed so that about half the pairs overlap
+static std::vector<std::pair<Box, Box>> makeBoxPairs(const int& count)
+{
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<float> px(0.0f, W), py(0.0f, H), sz(20.0f, 40.0f), angle(0.0f, 6.28318f), offset(-50.0f, 50.0f);
+
+	auto makeBox = [&](const phy::vec2& pos) {
+		phy::polygon p;
+		const float w = sz(gen), h = sz(gen);
+		p.vertices = { { -w/2, -h/2 }, { w/2, -h/2 }, { w/2, h/2 }, { -w/2, h/2 } };
+		p.pos = pos;
+		p.setRotation(angle(gen));
+		const auto& world = p.getWorldVertices();
+		return Box{ world[0], world[1], world[2], world[3] };
+	};
+
+	std::vector<std::pair<Box, Box>> pairs;
+	for(int i = 0; i < count; i++) {
+		const phy::vec2 pos{ px(gen), py(gen) };
+		pairs.push_back({ makeBox(pos), makeBox(pos + phy::vec2{ offset(gen), offset(gen) }) });
+	}
+	return pairs;
+}
+
+static void BM_LineToLine(benchmark::State& state)
+{
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<float> px(0.0f, W), py(0.0f, H);
+	std::vector<std::array<phy::vec2, 4>> lines(state.range(0));
+	for(auto& l: lines)
+		for(auto& p: l) p = { px(gen), py(gen) };
+
+	phy::collisionInfo info;
+	for(auto _: state) {
+		int hits = 0;
+		for(const auto& l: lines) hits += phy::collision::lineToLineIntersect(l[0], l[1], l[2], l[3], info);
+		benchmark::DoNotOptimize(hits);
+	}
+	state.SetItemsProcessed(state.iterations() * lines.size());
+}
+
+static void BM_PolygonManifold(benchmark::State& state)
+{
+	const auto pairs = makeBoxPairs(state.range(0));
+	phy::manifold m;
+	for(auto _: state) {
+		int hits = 0;
+		for(const auto& [a, b]: pairs) hits += phy::collision::polygonManifold(a, b, m);
+		benchmark::DoNotOptimize(hits);
+	}
+	state.SetItemsProcessed(state.iterations() * pairs.size());
+}
+
+static void BM_Gjk(benchmark::State& state)
+{
+	const auto pairs = makeBoxPairs(state.range(0));
+	phy::contactInfo contact;
+	for(auto _: state) {
+		int hits = 0;
+		for(const auto& [a, b]: pairs) hits += phy::collision::gjk({ a }, { b }, contact);
+		benchmark::DoNotOptimize(hits);
+	}
+	state.SetItemsProcessed(state.iterations() * pairs.size());
+}
+
+// the ballPhysics response on pairs that all overlap; the state is restored every
+// iteration (a plain copy, timed along with the resolution)
+static void BM_CircleToCircle(benchmark::State& state)
+{
+	struct Ball { phy::vec2 pos, vel; float radius, mass; };
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<float> px(0.0f, W), py(0.0f, H), r(10.0f, 20.0f), v(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> angle(0.0f, 6.28318f), depth(0.2f, 0.9f);
+
+	// b's centre sits 20-90% of the radius sum away from a's, in a random direction
+	std::vector<std::pair<Ball, Ball>> initial(state.range(0));
+	for(auto& [a, b]: initial) {
+		const float ra = r(gen), rb = r(gen);
+		const float direction = angle(gen), distance = (ra + rb) * depth(gen);
+		const phy::vec2 offset = phy::vec2::fromAngle(direction, distance);
+		a = { { px(gen), py(gen) }, { v(gen), v(gen) }, ra, ra * 0.5f };
+		b = { a.pos + offset, { v(gen), v(gen) }, rb, rb * 0.5f };
+	}
+
+	auto pairs = initial;
+	for(auto _: state) {
+		pairs = initial;
+		for(auto& [a, b]: pairs)
+			phy::collision::circleToCircle(a.pos, a.vel, a.radius, a.mass, b.pos, b.vel, b.radius, b.mass);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * pairs.size());
+}
+
+// one XPBD substep over a square cloth of structural sticks, as the verlet demo runs it
+static void BM_StickSolve(benchmark::State& state)
+{
+	const int side = static_cast<int>(std::sqrt(static_cast<float>(state.range(0))));
+	const float spacing = 5.0f;
+	phy::ParticleStore particles;
+	phy::XPBDSolver solver;
+	for(int y = 0; y < side; y++)
+		for(int x = 0; x < side; x++)
+			particles.add({ x * spacing, y * spacing }, 1, y == 0 ? 0.0f : 1.0f);
+	for(int y = 0; y < side; y++) {
+		for(int x = 0; x < side; x++) {
+			const phy::XPBDSolver::index_type i = y * side + x;
+			if(x + 1 < side) solver.addDistance(i, i + 1, spacing, 1e-6f);
+			if(y + 1 < side) solver.addDistance(i, i + side, spacing, 1e-6f);
+		}
+	}
+
+	const float h = 1.0f / 600;
+	for(auto _: state) {
+		particles.integrate(h, { 0, 50 }, 0.998f);
+		solver.solve(particles.x, particles.y, particles.invMass, h);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * solver.size());
+}
+
+static void BM_VerletIntegrate(benchmark::State& state)
+{
+	phy::ParticleStore particles;
+	particles.reserve(state.range(0));
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<float> px(0.0f, W), py(0.0f, H);
+	for(int i = 0; i < state.range(0); i++) particles.add({ px(gen), py(gen) }, 3);
+
+	for(auto _: state) {
+		particles.integrate(1.0f / 60, { 0, 50 }, 0.98f);
+		particles.constrainToBox(0, W, H, 0.98f, 0.85f);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * particles.size());
+}
+
+// falling bodies with linear drag, the integrationScheme demo's forces
+static void BM_RK4(benchmark::State& state)
+{
+	std::vector<phy::vec2> pos(state.range(0)), vel(state.range(0));
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<float> px(0.0f, W), v(-10.0f, 10.0f);
+	for(size_t i = 0; i < pos.size(); i++) {
+		pos[i] = { px(gen), 0 };
+		vel[i] = { v(gen), v(gen) };
+	}
+
+	auto acceleration = [](const phy::vec2&, const phy::vec2& v) { return phy::vec2{ 0, 10 } + v * -0.1f; };
+	for(auto _: state) {
+		for(size_t i = 0; i < pos.size(); i++) phy::integrator::rk4(pos[i], vel[i], 1.0f / 60, acceleration);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * pos.size());
+}
+
+BENCHMARK(BM_LineToLine) ENTITY_COUNTS;
+BENCHMARK(BM_PolygonManifold) ENTITY_COUNTS;
+BENCHMARK(BM_Gjk) ENTITY_COUNTS;
+BENCHMARK(BM_CircleToCircle) ENTITY_COUNTS;
+BENCHMARK(BM_StickSolve) ENTITY_COUNTS;
+BENCHMARK(BM_VerletIntegrate) ENTITY_COUNTS;
+BENCHMARK(BM_RK4) ENTITY_COUNTS;
@@ -0,0 +1,108 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+#include "../small/include/phy/quadtree.h"
+#include "../small/include/phy/linearquadtree.h"
+#include "../small/include/phy/spatialhash.h"
+
+// the small/quadtree.cpp scene: 15-30px blocks on a 1024x640 window, capacity 4,
+// minArea 500, queried with the 200x200 box that follows the mouse
+constexpr float W = 1024;
+constexpr float H = 640;
+
+static std::vector<phy::Rect2D> makeBlocks(const int& count)
+{
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<float> px(0.0f, W - 30.0f), py(0.0f, H - 30.0f), sz(15.0f, 30.0f);
+
+	std::vector<phy::Rect2D> blocks;
+	for(int i = 0; i < count; i++)
+		blocks.push_back(phy::Rect2D{ { px(gen), py(gen) }, { sz(gen), sz(gen) } });
+	return blocks;
+}
+
+static std::vector<phy::Rect2D> makeRanges()
+{
+	std::mt19937 gen(7);
+	std::uniform_real_distribution<float> px(-100.0f, W - 100.0f), py(-100.0f, H - 100.0f);
+
+	std::vector<phy::Rect2D> ranges;
+	for(int i = 0; i < 256; i++)
+		ranges.push_back(phy::Rect2D{ { px(gen), py(gen) }, { 200, 200 } });
+	return ranges;
+}
+
+// SpatialHashGrid behind the quadtree surface: 32px cells fit the largest block, and
+// like the linear tree it builds on the first query after an insert
+struct HashGrid {
+	phy::SpatialHashGrid<phy::Rect2D> grid;
+	bool dirty = false;
+
+	void resize(const phy::Rect2D& b, const int&, const float&) {
+		grid.resize(b, 32);
+		dirty = false;
+	}
+
+	bool insert(phy::Rect2D* object) {
+		dirty = true;
+		return grid.insert(object);
+	}
+
+	template<typename F>
+	void query(const phy::Rect2D& range, F&& visitor) {
+		refresh();
+		grid.query(range, visitor);
+	}
+
+	void getRange(const phy::Rect2D& range, std::vector<phy::Rect2D*>& queried) {
+		refresh();
+		grid.getRange(range, queried);
+	}
+
+	void refresh() {
+		if(dirty) grid.build();
+		dirty = false;
+	}
+};
+
+template<typename Tree>
+static void BM_Rebuild(benchmark::State& state)
+{
+	auto blocks = makeBlocks(state.range(0));
+	Tree tree;
+	for(auto _: state) {
+		tree.resize(phy::Rect2D{ { 0, 0 }, { W, H } }, 4, 500);
+		for(auto& block: blocks) tree.insert(&block);
+		// the linear tree sorts on its first query, so count that as part of the build
+		tree.query(phy::Rect2D{}, [](phy::Rect2D*) {});
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * blocks.size());
+}
+
+template<typename Tree>
+static void BM_Query(benchmark::State& state)
+{
+	auto blocks = makeBlocks(state.range(0));
+	const auto ranges = makeRanges();
+	Tree tree;
+	tree.resize(phy::Rect2D{ { 0, 0 }, { W, H } }, 4, 500);
+	for(auto& block: blocks) tree.insert(&block);
+
+	std::vector<phy::Rect2D*> queried;
+	size_t i = 0;
+	for(auto _: state) {
+		queried.clear();
+		tree.getRange(ranges[i++ % ranges.size()], queried);
+		benchmark::DoNotOptimize(queried.data());
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_Rebuild<phy::Quadtree<phy::Rect2D>>)->Arg(1000)->Arg(10000)->Arg(100000);
+BENCHMARK(BM_Rebuild<phy::LinearQuadtree<phy::Rect2D>>)->Arg(1000)->Arg(10000)->Arg(100000);
+BENCHMARK(BM_Rebuild<HashGrid>)->Arg(1000)->Arg(10000)->Arg(100000);
+BENCHMARK(BM_Query<phy::Quadtree<phy::Rect2D>>)->Arg(1000)->Arg(10000)->Arg(100000);
+BENCHMARK(BM_Query<phy::LinearQuadtree<phy::Rect2D>>)->Arg(1000)->Arg(10000)->Arg(100000);
+BENCHMARK(BM_Query<HashGrid>)->Arg(1000)->Arg(10000)->Arg(100000);
@@ -11,6 +11,12 @@
 
 #include "./include/phy/vec2.h"
 #include "./include/phy/geometry.h"
+#include "./include/phy/collision.h"
+#include "./include/phy/quadtree.h"
+#include "./include/phy/islands.h"
+#include "./include/phy/profiler.h"
+#include "./include/phy/headless.h"
+#include "./include/phy/perfhud.h"
 
 using namespace phy;
 
@@ -28,102 +34,17 @@ bool processEvent(SDL_Event& evt);
 void drawFilledCircle(SDL_Renderer* r, float px, float py, float radius);
 bool pointInRect(const SDL_FPoint& point, const SDL_FRect& rect);
 bool rectToRectIntersect(const SDL_FRect& a, const SDL_FRect& b);
+void renderQuadtree(SDL_Renderer* renderer, const phy::Quadtree<phy::Rect2D>::Node& node);
 
 class Ball;
 
 
-template<typename T>
-class Quadtree {
-
-    int capacity = 4;
-    SDL_FRect boundary;
-
-    public:
-        std::vector<T> objects;
-        bool isDivided = false;
-
-        std::vector<Quadtree> children;
-
-        Quadtree() = default;
-
-        Quadtree(const SDL_FRect& r, int maxObj = 4) {
-            boundary = r;
-            capacity = maxObj;
-        }
-
-        void insert(const T& object) {
-            if(!pointInRect(SDL_FPoint{ object->pos.x, object->pos.y }, boundary)) return;
-
-            if(objects.size() < capacity) {
-                objects.emplace_back(object);
-            } else {
-                if(!isDivided) {
-                    isDivided = true;
-                    const float wHalf = boundary.w / 2;
-                    const float hHalf = boundary.h / 2;
-                    children.push_back(Quadtree({ boundary.x, boundary.y, wHalf, hHalf }, capacity));
-                    children.push_back(Quadtree({ boundary.x + wHalf, boundary.y, wHalf, hHalf }, capacity));
-                    children.push_back(Quadtree({ boundary.x, boundary.y + hHalf, wHalf, hHalf }, capacity));
-                    children.push_back(Quadtree({ boundary.x + wHalf, boundary.y + hHalf, wHalf, hHalf }, capacity));
-
-                    for(auto it = objects.begin(); it != objects.end(); it++) {
-                        for(int i = 0; i < children.size(); i++) {
-                            auto& child = children[i];
-                            child.insert(*it);
-                        }
-                    }
-
-                    objects.clear();
-
-                }   // if !isDivided ends
-            }
-
-            if(isDivided) {
-                for(auto& child: children) {
-                    child.insert(object);
-                }
-            }
-
-        }
-
-        std::vector<T> findObject(const decltype(boundary)& range) {
-            if(!rectToRectIntersect(boundary, range)) return {};
-
-            std::vector<T> res;
-
-            if(!isDivided) {
-                for(auto& object: objects) {
-                    if(pointInRect({ object->pos.x, object->pos.y }, range)) res.emplace_back(object);
-                }
-                return res;
-            }
-
-            else {
-                for(auto& child: children) {
-                    auto pt = child.findObject(range);
-                    res.insert(res.begin(), pt.begin(), pt.end());
-                }
-            }
-
-            return res;
-        }
-
-        size_t size() const {
-            return objects.size();
-        }
-
-        void render(SDL_Renderer* renderer) {
-            SDL_RenderRect(renderer, &boundary);
-            for(auto& child: children) 
-                child.render(renderer);
-
-            for(auto& object: objects) {
-                drawFilledCircle(renderer, object->pos.x, object->pos.y, 1);
-            }
-        }
-};
-
-Quadtree<Ball*> qtree;
+phy::Quadtree<phy::Rect2D> qtree;
+std::vector<phy::Rect2D> ballBounds;    // ballBounds[i] is the box of balls[i]
+phy::Islands islands;                   // same indices as balls
+phy::PerfHud hud;
+size_t candidateCount = 0;              // quadtree hits of the last step, each pair seen from both balls
+size_t contactCount = 0;                // of those, the ones actually touching
 
 
 int selectedIndex = 0;
@@ -197,39 +118,9 @@ class Ball {
 
             for(auto& ball: balls) {
 
-                if(ball != this) {
-                    auto dist = ball->pos - pos;
-                    const float maxRadius = radius + ball->radius;
-                    const float dl = dist.length();
-
-                    if(dl < maxRadius) {
-                        auto normal = dist.normalize();
-                        auto displ = normal * ((maxRadius - dl) * 0.5f);
-                        pos -= displ;
-                        ball->pos += displ;
-
-                        auto normalVel1 = normal * vel.dotProduct(normal);
-                        auto normalVel2 = normal * ball->vel.dotProduct(normal);
-
-                        auto tangentVel1 = vel - normalVel1;
-                        auto tangetVel2 = ball->vel - normalVel2;
-
-                        const float m1 = mass;
-                        const float m2 = ball->mass;
-                        const float u1 = normalVel1.dotProduct(normal);
-                        const float u2 = normalVel2.dotProduct(normal);
-                        
-                        const float v1 = ((m1-m2)*u1+2*m2*u2)/(m1+m2);
-                        const float v2 = ((m2-m1)*u2+2*m1*u1)/(m1+m2);
-
-                        normalVel1 = normal * v1;
-                        normalVel2 = normal * v2;
-
-                        vel = tangentVel1 + normalVel1;
-                        ball->vel = tangetVel2 + normalVel2;
-                        acc = phy::vec2{ 0, 0 };
-                        ball->acc = phy::vec2{ 0, 0 };
-                    }
+                if(ball != this && collision::circleToCircle(pos, vel, radius, mass, ball->pos, ball->vel, ball->radius, ball->mass)) {
+                    acc = phy::vec2{ 0, 0 };
+                    ball->acc = phy::vec2{ 0, 0 };
                 }
             }
         }
@@ -247,6 +138,16 @@ void init()
     }
     balls.push_back({ {randRange(0, W), 0}, 20, 20 * 0.5f });
 
+    // leave headroom above the screen, balls spawn partly outside it
+    ballBounds.assign(balls.size(), phy::Rect2D{});
+    qtree.resize(phy::Rect2D{ {-100.0f, -100.0f}, {W + 200.0f, H + 200.0f} }, 4, 400);
+    for(int i = 0; i < balls.size(); i++) {
+        auto& ball = balls[i];
+        ballBounds[i] = phy::Rect2D{ ball.pos - vec2{ ball.radius, ball.radius }, vec2{ ball.radius, ball.radius } * 2.0f };
+        qtree.insert(&ballBounds[i]);
+    }
+    islands.resize(balls.size());
+
     t0 = std::chrono::high_resolution_clock::now().time_since_epoch();
 }
 
@@ -255,7 +156,7 @@ void render(SDL_Renderer* renderer)
     for(auto& ball: balls) ball.render(renderer);
 
     SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-    qtree.render(renderer);
+    renderQuadtree(renderer, qtree.getRoot());
 }
 
 
@@ -263,7 +164,7 @@ void physicsProcess(const float& dt)
 {
     selectedBall = &(balls[selectedIndex % balls.size()]);
 
-    std::vector<Ball*> collidingBall;
+    static std::vector<Ball*> collidingBall;
 
     // for(auto& ball: balls) {
     //     ball.pos += ball.vel * dt;
@@ -271,37 +172,71 @@ void physicsProcess(const float& dt)
     //     ball.acc = ball.force * (1/ball.mass);
     //     ball.vel += ball.acc * dt;
     // }
-    qtree = Quadtree<Ball*>({ 0, 0, W, H }, 4);
-        
-    for(auto& ball: balls) {
-        ball.vel += ball.acc * (dt * 0.5f);
-        if(ball.vel.length() < 0.01f) ball.vel *= 0.0f;
-    }
-
-    for(auto& ball: balls) {
-        ball.pos += ball.vel * dt;
+    // sleeping balls are neither moved nor collided until an awake one touches them
+    {
+        PHY_ZONE("integrate");
+        for(int i = 0; i < balls.size(); i++) {
+            auto& ball = balls[i];
+            if(!islands.isAwake(i)) continue;
+            ball.vel += ball.acc * (dt * 0.5f);
+            if(ball.vel.length() < 0.01f) ball.vel *= 0.0f;
+            ball.pos += ball.vel * dt;
+        }
     }
 
-    for(auto& ball: balls) {
-        qtree.insert(&ball);
+    // only balls that left their quadtree node get moved
+    {
+        PHY_ZONE("broadphase");
+        for(int i = 0; i < balls.size(); i++) {
+            if(!islands.isAwake(i)) continue;
+            auto& ball = balls[i];
+            ballBounds[i].pos = ball.pos - vec2{ ball.radius, ball.radius };
+            qtree.update(&ballBounds[i]);
+        }
+        qtree.merge();
     }
 
     // for(int i = 0; i < 2; i++)
-    for(int i = 0; i < balls.size(); i++) {
-        auto& ball = balls[i];
-        auto ranged = qtree.findObject({ ball.pos.x - 50, ball.pos.y - 50, 100, 100 });
-        ball.ballToBallCollision(ranged);
-        ball.checkWallBounce();
+    {
+        PHY_ZONE("narrowphase");
+        candidateCount = contactCount = 0;
+        for(int i = 0; i < balls.size(); i++) {
+            if(!islands.isAwake(i)) continue;
+            auto& ball = balls[i];
+            collidingBall.clear();
+            // any ball touching this one has its box within one radius of the centre
+            qtree.queryRadius(ball.pos, ball.radius, [&](phy::Rect2D* bounds) {
+                const int j = bounds - ballBounds.data();
+                auto& other = balls[j];
+                candidateCount += j != i;
+                if(j != i && (other.pos - ball.pos).length() < ball.radius + other.radius) {
+                    islands.addContact(i, j);
+                    contactCount++;
+                }
+                collidingBall.push_back(&other);
+            });
+            ball.ballToBallCollision(collidingBall);
+            ball.checkWallBounce();
 
+        }
     }
         
-    for(auto& ball: balls) {
-        ball.force = { 0, ball.mass * 10 };
-        ball.acc = ball.force * (1/ball.mass);
-        ball.vel += ball.acc * (dt * 0.5f);
+    {
+        PHY_ZONE("forces");
+        for(int i = 0; i < balls.size(); i++) {
+            auto& ball = balls[i];
+            if(!islands.isAwake(i)) continue;
+            ball.force = { 0, ball.mass * 10 };
+            ball.acc = ball.force * (1/ball.mass);
+            ball.vel += ball.acc * (dt * 0.5f);
+        }
     }
-}
 
+    PHY_ZONE("islands");
+    islands.update(dt, [](const auto& i) {
+        return balls[i].vel.length() < 1.0f;
+    });
+}
 
 void update(const float& dt, SDL_Renderer* renderer) 
 {
@@ -320,6 +255,7 @@ bool processEvent(SDL_Event& evt) {
 			return true;
 		case SDL_EVENT_KEY_DOWN:
             if(!selectedBall) break;
+            islands.wake(selectedBall - balls.data());
 
             switch(evt.key.key) {
                 case SDLK_LEFT:
@@ -340,6 +276,9 @@ bool processEvent(SDL_Event& evt) {
                 case SDLK_D:
                     selectedBall->pos.x++;
                     break;
+                case SDLK_H:
+                    hud.visible = !hud.visible;
+                    break;
             }
             break;
 
@@ -354,8 +293,14 @@ bool processEvent(SDL_Event& evt) {
 }
 
 
-int main()
+int main(int argc, char** argv)
 {
+	// --headless [ticks] steps the world without opening a window
+	if(const int ticks = phy::headlessTicks(argc, argv)) {
+		init();
+		return phy::runHeadless("ballPhysics", ticks, fixedTimeStep, physicsProcess);
+	}
+
 	if (SDL_Init(SDL_INIT_VIDEO) <= 0)
 	{
 		SDL_Log("SDL_INITIALIZATION ERROR: %s", SDL_GetError());
@@ -381,6 +326,7 @@ int main()
 	init();
 	while (!windowShouldClose)
 	{
+		PHY_ZONE("frame");
 		while (SDL_PollEvent(&evt))
 			windowShouldClose = processEvent(evt);
         const auto now = std::chrono::high_resolution_clock::now().time_since_epoch();
@@ -389,18 +335,29 @@ int main()
 
         timeAccumulator += dt;
 
+        const auto physicsStart = std::chrono::steady_clock::now();
         while(timeAccumulator >= fixedTimeStep) {
             physicsProcess(fixedTimeStep);
             timeAccumulator -= fixedTimeStep;
         }
+        hud.setPhysicsTime(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - physicsStart).count());
+        hud.setCounter("BODIES", balls.size());
+        hud.setCounter("PAIRS", candidateCount);
+        hud.setCounter("CONTACTS", contactCount);
+        hud.setCounter("QUADTREE NODES", qtree.nodeCount());
 
 		update(dt, renderer);
-		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-		SDL_RenderClear(renderer);
-		render(renderer);
+		{
+			PHY_ZONE("render");
+			SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+			SDL_RenderClear(renderer);
+			render(renderer);
+			hud.render(renderer);
+		}
 		SDL_RenderPresent(renderer);
 	}
 
+	if(phy::hasFlag(argc, argv, "--trace")) PHY_PROFILE_DUMP("ballPhysics.trace.json");
 	SDL_DestroyWindow(window);
 	SDL_Quit();
 	return 0;
@@ -456,4 +413,13 @@ float randRange(const float& min, const float& max)
     std::mt19937 gen(rd());
     std::uniform_int_distribution<> dist(min, max);
     return dist(gen);
+}
+
+
+void renderQuadtree(SDL_Renderer* renderer, const phy::Quadtree<phy::Rect2D>::Node& node)
+{
+    SDL_FRect rect{ node.boundary.pos.x, node.boundary.pos.y, node.boundary.size.x, node.boundary.size.y };
+    SDL_RenderRect(renderer, &rect);
+    for(auto& child: qtree.getChildren(node))
+        renderQuadtree(renderer, child);
 }
\ No newline at end of file
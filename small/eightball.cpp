@@ -14,6 +14,10 @@ TODO: once ball rect has intersect with a static ball, just ignore other collisi
 #include <SDL3_image/SDL_image.h>
 
 #include "./include/phy/vec2.h"
+#include "./include/phy/sweepandprune.h"
+#include "./include/phy/islands.h"
+#include "./include/phy/profiler.h"
+#include "./include/phy/headless.h"
 
 constexpr int W = 2048 * 0.5;
 constexpr int H = 1156 * 0.5;
@@ -87,6 +91,7 @@ struct Vertex
 	phy::vec2 pos, vel;
 	float mass = 1.0f;
 	bool isStatic = false;
+	phy::Islands::index_type index = 0;		// position in the world's body list
 
 	BodyType type = BodyType::DEFAULT;
 
@@ -137,6 +142,10 @@ class PhysicsWorld
 {
 	using body_type = std::unique_ptr<Vertex>;
 	std::vector<body_type> bodies;
+	std::vector<phy::SweepAndPrune<Vertex>::index_type> proxies;	// proxies[i] belongs to bodies[i]
+	phy::SweepAndPrune<Vertex> broadphase;
+	phy::Islands islands;
+	const float restSpeed = 0.5f;
 	const float dragFactor = 0.2f;
 	const float wallFriction = 0.9f;
 
@@ -150,51 +159,87 @@ class PhysicsWorld
 		static_assert(std::is_base_of_v<Vertex, T>);
 		auto body = std::make_unique<T>(std::forward<Args>(args)...);
 		T& ref = *body;
+		ref.index = bodies.size();
 		bodies.push_back(std::move(body));
+		proxies.push_back(phy::SweepAndPrune<Vertex>::npos);
 		return ref;
 	}
 
+	// puts body's island back into the simulation, e.g. after a shot
+	void wake(Vertex* body) {
+		if(body->index < islands.size()) islands.wake(body->index);
+	}
+
 	void update(const float& dt) 
 	{
-		// update position
-		int i = 0;
-		for(auto& body: bodies) {
-			if(body->isStatic) continue;
-			body->pos += body->vel * dt;
-			if(body->vel.length() < 0.01f) {
-				body->vel.x = 0;
-				body->vel.y = 0;
+		// isStatic is set after createObject returns, so islands start here
+		if(islands.size() != bodies.size()) {
+			islands.resize(bodies.size());
+			for(auto& body: bodies) islands.setStatic(body->index, body->isStatic);
+		}
+
+		// update position; sleeping balls stay put
+		{
+			PHY_ZONE("integrate");
+			for(auto& body: bodies) {
+				if(!islands.isAwake(body->index)) continue;
+				body->pos += body->vel * dt;
+				if(body->vel.length() < 0.01f) {
+					body->vel.x = 0;
+					body->vel.y = 0;
+				}
 			}
-			i++;
 		}
 
 		// get collision
-		for(int i = 0; i < bodies.size(); i++) {
-			auto& body1 = bodies[i];
-			if(body1->type != BodyType::BALL || body1->isStatic) continue;
-
-			for(int j = i + 1; j < bodies.size(); j++) {
-				auto& body2 = bodies[j];
-				auto b1 = body1->getBoundary();
-				auto b2 = body2->getBoundary();
-				if(b1.pos.x < b2.pos.x + b2.size.x &&
-					b1.pos.x + b1.size.x > b2.pos.x && 
-					b1.pos.y < b2.pos.y + b2.size.y && 
-					b1.pos.y + b1.size.y > b2.pos.y
-				) {
-					ballToBallCollisionResolve(body1, body2);
-					ballToWallCollisionResolve(body1, body2);
+		{
+			PHY_ZONE("broadphase");
+			for(int i = 0; i < bodies.size(); i++) {
+				auto& body = bodies[i];
+				auto b = body->getBoundary();
+				phy::Rect2D bounds{ b.pos, b.size };
+				// bodies are set up once createObject returns, so proxies start here
+				if(proxies[i] == phy::SweepAndPrune<Vertex>::npos) {
+					proxies[i] = broadphase.add(body.get(), bounds, body->isStatic);
+					continue;
 				}
+				// synced before the sweep, so a body woken since the last step already
+				// pairs with sleeping balls and walls this step
+				if(!body->isStatic) broadphase.setStatic(proxies[i], !islands.isAwake(i));
+				if(islands.isAwake(i)) broadphase.move(proxies[i], bounds);
+			}
+			broadphase.update();
+		}
+
+		// a pair always has an awake body: sleeping ones sit in the broadphase as static
+		{
+			PHY_ZONE("narrowphase");
+			for(auto [body1, body2]: broadphase.getPairs()) {
+				if(body1->type != BodyType::BALL || !islands.isAwake(body1->index)) std::swap(body1, body2);
+				if(body1->type != BodyType::BALL || !islands.isAwake(body1->index)) continue;
+
+				if(ballToBallCollisionResolve(body1, body2) || ballToWallCollisionResolve(body1, body2))
+					islands.addContact(body1->index, body2->index);
 			}
 		}
 
 		// update force, acc, velocity
-		for(auto& body: bodies) {
-			if(body->isStatic) continue;
-			auto force = body->vel * -dragFactor;
-			auto acc = force * (1 / body->mass);
-			body->vel += acc * dt;
+		{
+			PHY_ZONE("forces");
+			for(auto& body: bodies) {
+				if(!islands.isAwake(body->index)) continue;
+				auto force = body->vel * -dragFactor;
+				auto acc = force * (1 / body->mass);
+				body->vel += acc * dt;
+			}
 		}
+
+		PHY_ZONE("islands");
+		islands.update(dt, [&](const auto& i) {
+			return bodies[i]->vel.length() < restSpeed;
+		});
+		for(auto& body: bodies)
+			if(!body->isStatic && !islands.isAwake(body->index)) body->vel = { 0, 0 };
 	}
 
 	void render(SDL_Renderer* renderer) 
@@ -232,10 +277,11 @@ class PhysicsWorld
 	}
 
 	private:
-		void ballToWallCollisionResolve(body_type& body1, body_type& body2)
+		// both resolvers report whether the bodies touched
+		bool ballToWallCollisionResolve(Vertex* body1, Vertex* body2)
 		{
 			if(body2->type != BodyType::WALL)
-				return;
+				return false;
 			
 			auto ball = dynamic_cast<Ball*>(&(*body1));
 			auto wall = dynamic_cast<Wall*>(&(*body2));
@@ -244,40 +290,45 @@ class PhysicsWorld
 				if(body1->pos.y - ball->radius < wall->start.y) {
 					body1->pos.y = wall->start.y + ball->radius;
 					ball->vel.y *= -wallFriction;
+					return true;
 				}
-				return;
+				return false;
 			}
 
 			if(wall->position == WallPos::BOTTOM) {
 				if(body1->pos.y + ball->radius > wall->start.y) {
 					body1->pos.y = wall->start.y - ball->radius;
 					ball->vel.y *= -wallFriction;
+					return true;
 				}
-				return;
+				return false;
 			}
 
 			if(wall->position == WallPos::LEFT) {
 				if(body1->pos.x - ball->radius < wall->start.x) {
 					body1->pos.x = wall->start.x + ball->radius;
 					ball->vel.x *= -wallFriction;
+					return true;
 				}
-				return;
+				return false;
 			}
 
 			if(wall->position == WallPos::RIGHT) {
 				if(body1->pos.x + ball->radius > wall->start.x) {
 					body1->pos.x = wall->start.x - ball->radius;
 					ball->vel.x *= -wallFriction;
+					return true;
 				}
-				return;
+				return false;
 			}
 
+			return false;
 		}
 
-		void ballToBallCollisionResolve(body_type& body1, body_type& body2)
+		bool ballToBallCollisionResolve(Vertex* body1, Vertex* body2)
 		{
 			if(body1->type != BodyType::BALL || body2->type != BodyType::BALL)
-				return;
+				return false;
 
 			auto b1 = dynamic_cast<Ball*>(&(*body1));
 			auto b2 = dynamic_cast<Ball*>(&(*body2));
@@ -289,8 +340,7 @@ class PhysicsWorld
 			if(body2->isStatic && distLen < maxRadius * 0.5f) {
 				body1->vel *= 0.0f;
 				// body1->pos = body2->pos;
-				std::cout << "Hello wotld" << std::endl;
-				return;
+				return true;
 			}
 
 			if(distLen < maxRadius) {
@@ -322,8 +372,10 @@ class PhysicsWorld
 
 				body1->vel = normalVel1 + tangentVel1;
 				body2->vel = normalVel2 + tangentVel2;
+				return true;
 			}
-			
+
+			return false;
 		}
 
 } world;
@@ -420,8 +472,15 @@ bool init()
 }
 
 
-int main()
+int main(int argc, char** argv)
 {
+	// --headless [ticks] plays the break shot without opening a window
+	if(const int ticks = phy::headlessTicks(argc, argv)) {
+		init();
+		balls[0]->vel = { -200.0f, 2.0f };
+		return phy::runHeadless("eightball", ticks, fixedTimeStep, [](const float& dt) { world.update(dt); });
+	}
+
 	canvas.window = SDL_CreateWindow("EightBall", W, H, 0);
 	canvas.renderer = SDL_CreateRenderer(canvas.window, nullptr);
 
@@ -443,6 +502,7 @@ int main()
 	init();
 
 	animate();
+	if(phy::hasFlag(argc, argv, "--trace")) PHY_PROFILE_DUMP("eightball.trace.json");
 	SDL_DestroyWindow(canvas.window);
 	SDL_Quit();
 	return 0;
@@ -484,6 +544,7 @@ void pollEvent(SDL_Event& evt)
 			if(vel.length() * 0.5f > maxSpeed) 
 				vel = nVel * maxSpeed;
 			selectedBall->vel = vel;
+			world.wake(selectedBall);
 			selectedBall = nullptr;
 		}
 	}
@@ -494,6 +555,7 @@ void animate()
 	t0 = std::chrono::high_resolution_clock::now().time_since_epoch();
 	while (!canvas.windowShouldClose)
 	{
+		PHY_ZONE("frame");
 		auto t1 = std::chrono::high_resolution_clock::now().time_since_epoch();
 		const float dt = (t1 - t0).count() * 10e-9;
 		t0 = t1;
@@ -506,9 +568,12 @@ void animate()
 			fixedTimeAccumulator -= fixedTimeStep;
 		}
 
-		SDL_SetRenderDrawColor(canvas.renderer, 0, 0, 0, 255);
-		SDL_RenderClear(canvas.renderer);
-		render(canvas.renderer);
+		{
+			PHY_ZONE("render");
+			SDL_SetRenderDrawColor(canvas.renderer, 0, 0, 0, 255);
+			SDL_RenderClear(canvas.renderer);
+			render(canvas.renderer);
+		}
 		SDL_RenderPresent(canvas.renderer);
 	}
 }
@@ -526,7 +591,9 @@ void initBalls()
 		return ball;
 	};
 	
-	float rad = textures["ball_1"].w * 0.12f;
+	// ball_1.png is 145 px wide; headless runs load no textures
+	const float textureWidth = textures["ball_1"].w > 0 ? textures["ball_1"].w : 145.0f;
+	float rad = textureWidth * 0.12f;
 	auto& cueBall = createBall(W * 0.85f, H * 0.5f, rad);
 	cueBall.textureId = 16;
 	balls.push_back(&cueBall);
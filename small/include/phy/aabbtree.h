@@ -0,0 +1,488 @@
+#ifndef __PHY_AABB_TREE_H__
+#define __PHY_AABB_TREE_H__
+
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#include <type_traits>
+
+#include "vec2.h"
+#include "geometry.h"
+#include "broadphase.h"
+
+namespace phy {
+
+    // Dynamic bounding volume hierarchy for scenes that mix tiny bodies with long static
+    // geometry. Every proxy is a leaf holding a fattened box (bounds grown by margin) so
+    // small motions don't touch the tree. move() only reinserts a leaf once its bounds
+    // leave the fat box. A new leaf goes next to the sibling that adds the least
+    // perimeter (the 2D surface area heuristic), and AVL-style rotations on the way back
+    // up keep the height logarithmic.
+    //
+    // Nodes live in one pooled array linked by 32-bit index; freed nodes are recycled,
+    // and all traversals run on a fixed stack.
+    template<typename T>
+    class AABBTree {
+
+        public:
+            using index_type = std::uint32_t;
+            using Pair = BroadphasePair<T>;
+            static constexpr index_type npos = ~index_type(0);
+            static constexpr size_t stackSize = 256;
+
+        private:
+            struct Node {
+                Rect2D box;
+                T* object = nullptr;
+                index_type parent = npos;       // next free node while on the free list
+                index_type child1 = npos;
+                index_type child2 = npos;
+                int height = -1;                // 0 for leaves, -1 for free nodes
+                bool isStatic = false;
+
+                bool isLeaf() const {
+                    return child1 == npos;
+                }
+            };
+
+            std::vector<Node> nodes;
+            std::vector<Pair> pairs;
+            index_type root = npos;
+            index_type freeList = npos;
+            size_t proxyCount = 0;
+            float margin = 2.0f;
+
+        public:
+
+            AABBTree() = default;
+
+            // extra room around every dynamic proxy's bounds
+            void setMargin(const float& m) {
+                margin = m;
+            }
+
+            void clear() {
+                nodes.clear();
+                pairs.clear();
+                root = npos;
+                freeList = npos;
+                proxyCount = 0;
+            }
+
+            // Static proxies keep their exact bounds and are never paired with each other.
+            index_type insert(T* object, const Rect2D& bounds, const bool& isStatic = false)
+            {
+                const index_type id = allocateNode();
+                nodes[id].box = isStatic ? bounds : fatten(bounds, margin);
+                nodes[id].object = object;
+                nodes[id].height = 0;
+                nodes[id].isStatic = isStatic;
+                insertLeaf(id);
+                proxyCount++;
+                return id;
+            }
+
+            void remove(const index_type& id)
+            {
+                removeLeaf(id);
+                freeNode(id);
+                proxyCount--;
+            }
+
+            // Returns true if the leaf had to be reinserted. displacement, when given, is
+            // the expected motion over the next step and stretches the fat box that way.
+            bool move(const index_type& id, const Rect2D& bounds, const vec2& displacement = { 0, 0 })
+            {
+                if(contains(nodes[id].box, bounds)) return false;
+
+                removeLeaf(id);
+
+                Rect2D box = fatten(bounds, margin);
+                const vec2 d = displacement * 2.0f;
+                if(d.x < 0) box.pos.x += d.x;
+                box.size.x += std::abs(d.x);
+                if(d.y < 0) box.pos.y += d.y;
+                box.size.y += std::abs(d.y);
+
+                nodes[id].box = box;
+                insertLeaf(id);
+                return true;
+            }
+
+            // Calls visitor(T*) for every proxy whose fat box overlaps range; returning
+            // false from a bool visitor ends the query.
+            template<typename F>
+            void query(const Rect2D& range, F&& visitor) const
+            {
+                queryProxies(range, [&](const index_type& id) {
+                    if constexpr (std::is_same_v<std::invoke_result_t<F&, T*>, bool>) {
+                        return visitor(nodes[id].object);
+                    } else {
+                        visitor(nodes[id].object);
+                        return true;
+                    }
+                });
+            }
+
+            void getRange(const Rect2D& range, std::vector<T*>& queried) const
+            {
+                query(range, [&](T* object) { queried.push_back(object); });
+            }
+
+            // Casts the segment p1 -> p2. For every leaf the segment may hit, calls
+            // callback(T*, p1, p2, maxFraction) and expects back a fraction along the
+            // segment: 0 stops the cast, a value below maxFraction clips the segment
+            // to the new closest hit, anything else leaves it unchanged.
+            template<typename F>
+            void rayCast(const vec2& p1, const vec2& p2, F&& callback, float maxFraction = 1.0f) const
+            {
+                if(root == npos) return;
+
+                vec2 r = p2 - p1;
+                if(r.length() == 0) return;
+                r = r.normalize();
+
+                const vec2 v{ -r.y, r.x };
+                const vec2 absV{ std::abs(v.x), std::abs(v.y) };
+
+                Rect2D segment = segmentBounds(p1, p2, maxFraction);
+
+                std::array<index_type, stackSize> stack;
+                size_t top = 0;
+                stack[top++] = root;
+
+                while(top) {
+                    const Node& node = nodes[stack[--top]];
+                    if(!overlaps(node.box, segment)) continue;
+
+                    // separating axis along the segment normal
+                    const vec2 h = node.box.size * 0.5f;
+                    const vec2 c = node.box.pos + h;
+                    const vec2 d = p1 - c;
+                    if(std::abs(v.x * d.x + v.y * d.y) - (absV.x * h.x + absV.y * h.y) > 0) continue;
+
+                    if(node.isLeaf()) {
+                        const float value = callback(node.object, p1, p2, maxFraction);
+                        if(value == 0.0f) return;
+                        if(value > 0.0f && value < maxFraction) {
+                            maxFraction = value;
+                            segment = segmentBounds(p1, p2, maxFraction);
+                        }
+                        continue;
+                    }
+
+                    assert(top + 2 <= stackSize);
+                    stack[top++] = node.child1;
+                    stack[top++] = node.child2;
+                }
+            }
+
+            // A static proxy is skipped by updatePairs() but still found by the others, so
+            // flagging sleeping bodies static takes them out of the pair search until
+            // an awake body reaches them.
+            void setStatic(const index_type& id, const bool& isStatic) {
+                nodes[id].isStatic = isStatic;
+            }
+
+            // Rebuilds the pair buffer: every dynamic proxy is queried against the tree and
+            // each overlapping fat-box pair is written once.
+            void updatePairs()
+            {
+                pairs.clear();
+                for(index_type id = 0; id < nodes.size(); id++) {
+                    const Node& node = nodes[id];
+                    if(node.height != 0 || node.isStatic) continue;
+
+                    queryProxies(node.box, [&](const index_type& other) {
+                        if(other == id || (!nodes[other].isStatic && other < id)) return true;
+                        pairs.push_back(Pair{ nodes[id].object, nodes[other].object });
+                        return true;
+                    });
+                }
+            }
+
+            // pairs found by the last updatePairs()
+            const std::vector<Pair>& getPairs() const {
+                return pairs;
+            }
+
+            const Rect2D& getFatBounds(const index_type& id) const {
+                return nodes[id].box;
+            }
+
+            T* getObject(const index_type& id) const {
+                return nodes[id].object;
+            }
+
+            int getHeight() const {
+                return root == npos ? 0 : nodes[root].height;
+            }
+
+            size_t size() const {
+                return proxyCount;
+            }
+
+            size_t nodeCount() const {
+                return nodes.size();
+            }
+
+        private:
+            template<typename F>
+            void queryProxies(const Rect2D& range, F&& visitor) const
+            {
+                if(root == npos) return;
+
+                std::array<index_type, stackSize> stack;
+                size_t top = 0;
+                stack[top++] = root;
+
+                while(top) {
+                    const index_type index = stack[--top];
+                    const Node& node = nodes[index];
+                    if(!overlaps(node.box, range)) continue;
+
+                    if(node.isLeaf()) {
+                        if(!visitor(index)) return;
+                        continue;
+                    }
+
+                    assert(top + 2 <= stackSize);
+                    stack[top++] = node.child1;
+                    stack[top++] = node.child2;
+                }
+            }
+
+            index_type allocateNode() {
+                index_type id = freeList;
+                if(id != npos) {
+                    freeList = nodes[id].parent;
+                    nodes[id] = Node();
+                } else {
+                    id = static_cast<index_type>(nodes.size());
+                    nodes.emplace_back();
+                }
+                return id;
+            }
+
+            void freeNode(const index_type& id) {
+                nodes[id] = Node();
+                nodes[id].parent = freeList;
+                freeList = id;
+            }
+
+            void insertLeaf(const index_type& leaf) {
+                if(root == npos) {
+                    root = leaf;
+                    nodes[leaf].parent = npos;
+                    return;
+                }
+
+                // walk down picking the cheaper side until making a new parent here is cheapest
+                const Rect2D leafBox = nodes[leaf].box;
+                index_type index = root;
+                while(!nodes[index].isLeaf()) {
+                    const Node& node = nodes[index];
+                    const float area = perimeter(node.box);
+                    const float combined = perimeter(merge(node.box, leafBox));
+
+                    const float cost = 2.0f * combined;
+                    const float inheritance = 2.0f * (combined - area);
+
+                    const float cost1 = descendCost(node.child1, leafBox) + inheritance;
+                    const float cost2 = descendCost(node.child2, leafBox) + inheritance;
+
+                    if(cost < cost1 && cost < cost2) break;
+                    index = cost1 < cost2 ? node.child1 : node.child2;
+                }
+
+                const index_type sibling = index;
+                const index_type oldParent = nodes[sibling].parent;
+                const index_type newParent = allocateNode();
+                nodes[newParent].parent = oldParent;
+                nodes[newParent].box = merge(leafBox, nodes[sibling].box);
+                nodes[newParent].height = nodes[sibling].height + 1;
+                nodes[newParent].child1 = sibling;
+                nodes[newParent].child2 = leaf;
+                nodes[sibling].parent = newParent;
+                nodes[leaf].parent = newParent;
+
+                if(oldParent == npos) root = newParent;
+                else if(nodes[oldParent].child1 == sibling) nodes[oldParent].child1 = newParent;
+                else nodes[oldParent].child2 = newParent;
+
+                refit(nodes[leaf].parent);
+            }
+
+            void removeLeaf(const index_type& leaf) {
+                if(leaf == root) {
+                    root = npos;
+                    return;
+                }
+
+                const index_type parent = nodes[leaf].parent;
+                const index_type grandParent = nodes[parent].parent;
+                const index_type sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+                if(grandParent == npos) {
+                    root = sibling;
+                    nodes[sibling].parent = npos;
+                    freeNode(parent);
+                    return;
+                }
+
+                if(nodes[grandParent].child1 == parent) nodes[grandParent].child1 = sibling;
+                else nodes[grandParent].child2 = sibling;
+                nodes[sibling].parent = grandParent;
+                freeNode(parent);
+
+                refit(grandParent);
+            }
+
+            // rebalances and recomputes boxes and heights from index up to the root
+            void refit(index_type index) {
+                while(index != npos) {
+                    index = balance(index);
+
+                    Node& node = nodes[index];
+                    const Node& a = nodes[node.child1];
+                    const Node& b = nodes[node.child2];
+                    node.height = 1 + std::max(a.height, b.height);
+                    node.box = merge(a.box, b.box);
+
+                    index = node.parent;
+                }
+            }
+
+            // rotates a grandchild up when one side is more than one level taller; returns
+            // the node now sitting where iA was
+            index_type balance(const index_type& iA) {
+                Node& A = nodes[iA];
+                if(A.isLeaf() || A.height < 2) return iA;
+
+                const index_type iB = A.child1;
+                const index_type iC = A.child2;
+                Node& B = nodes[iB];
+                Node& C = nodes[iC];
+                const int diff = C.height - B.height;
+
+                if(diff > 1) {
+                    const index_type iF = C.child1;
+                    const index_type iG = C.child2;
+                    Node& F = nodes[iF];
+                    Node& G = nodes[iG];
+
+                    C.child1 = iA;
+                    C.parent = A.parent;
+                    A.parent = iC;
+                    replaceChild(C.parent, iA, iC);
+
+                    if(F.height > G.height) {
+                        C.child2 = iF;
+                        A.child2 = iG;
+                        G.parent = iA;
+                        A.box = merge(B.box, G.box);
+                        C.box = merge(A.box, F.box);
+                        A.height = 1 + std::max(B.height, G.height);
+                        C.height = 1 + std::max(A.height, F.height);
+                    } else {
+                        C.child2 = iG;
+                        A.child2 = iF;
+                        F.parent = iA;
+                        A.box = merge(B.box, F.box);
+                        C.box = merge(A.box, G.box);
+                        A.height = 1 + std::max(B.height, F.height);
+                        C.height = 1 + std::max(A.height, G.height);
+                    }
+                    return iC;
+                }
+
+                if(diff < -1) {
+                    const index_type iD = B.child1;
+                    const index_type iE = B.child2;
+                    Node& D = nodes[iD];
+                    Node& E = nodes[iE];
+
+                    B.child1 = iA;
+                    B.parent = A.parent;
+                    A.parent = iB;
+                    replaceChild(B.parent, iA, iB);
+
+                    if(D.height > E.height) {
+                        B.child2 = iD;
+                        A.child1 = iE;
+                        E.parent = iA;
+                        A.box = merge(C.box, E.box);
+                        B.box = merge(A.box, D.box);
+                        A.height = 1 + std::max(C.height, E.height);
+                        B.height = 1 + std::max(A.height, D.height);
+                    } else {
+                        B.child2 = iE;
+                        A.child1 = iD;
+                        D.parent = iA;
+                        A.box = merge(C.box, D.box);
+                        B.box = merge(A.box, E.box);
+                        A.height = 1 + std::max(C.height, D.height);
+                        B.height = 1 + std::max(A.height, E.height);
+                    }
+                    return iB;
+                }
+
+                return iA;
+            }
+
+            void replaceChild(const index_type& parent, const index_type& from, const index_type& to) {
+                if(parent == npos) {
+                    root = to;
+                    return;
+                }
+                if(nodes[parent].child1 == from) nodes[parent].child1 = to;
+                else nodes[parent].child2 = to;
+            }
+
+            // perimeter a subtree gains from taking the new leaf
+            float descendCost(const index_type& child, const Rect2D& leafBox) const {
+                const Node& node = nodes[child];
+                const float combined = perimeter(merge(leafBox, node.box));
+                return node.isLeaf() ? combined : combined - perimeter(node.box);
+            }
+
+            static float perimeter(const Rect2D& r) {
+                return 2.0f * (r.size.x + r.size.y);
+            }
+
+            static Rect2D merge(const Rect2D& a, const Rect2D& b) {
+                const vec2 min{ std::min(a.pos.x, b.pos.x), std::min(a.pos.y, b.pos.y) };
+                const vec2 max{ std::max(a.pos.x + a.size.x, b.pos.x + b.size.x), std::max(a.pos.y + a.size.y, b.pos.y + b.size.y) };
+                return Rect2D{ min, max - min };
+            }
+
+            static Rect2D fatten(const Rect2D& r, const float& m) {
+                return Rect2D{ r.pos - vec2{ m, m }, r.size + vec2{ m, m } * 2.0f };
+            }
+
+            static Rect2D segmentBounds(const vec2& p1, const vec2& p2, const float& fraction) {
+                const vec2 t = p1 + (p2 - p1) * fraction;
+                const vec2 min{ std::min(p1.x, t.x), std::min(p1.y, t.y) };
+                const vec2 max{ std::max(p1.x, t.x), std::max(p1.y, t.y) };
+                return Rect2D{ min, max - min };
+            }
+
+            static bool contains(const Rect2D& outer, const Rect2D& inner) {
+                return inner.pos.x >= outer.pos.x && inner.pos.y >= outer.pos.y
+                    && inner.pos.x + inner.size.x <= outer.pos.x + outer.size.x
+                    && inner.pos.y + inner.size.y <= outer.pos.y + outer.size.y;
+            }
+
+            // closed test, so zero-width walls and axis-aligned rays still register
+            static bool overlaps(const Rect2D& a, const Rect2D& b) {
+                return a.pos.x <= b.pos.x + b.size.x && a.pos.x + a.size.x >= b.pos.x
+                    && a.pos.y <= b.pos.y + b.size.y && a.pos.y + a.size.y >= b.pos.y;
+            }
+    };
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,15 @@
+#ifndef __PHY_BROADPHASE_H__
+#define __PHY_BROADPHASE_H__
+
+namespace phy {
+
+    // candidate pair handed from a broadphase to the narrowphase
+    template<typename T>
+    struct BroadphasePair {
+        T* a = nullptr;
+        T* b = nullptr;
+    };
+
+}
+
+#endif
\ No newline at end of file
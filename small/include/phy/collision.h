@@ -1,6 +1,13 @@
 #ifndef __COLLISION_RB_H__
 #define __COLLISION_RB_H__
 
+#include <span>
+#include <array>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
 #include "vec2.h"
 
 namespace phy {
@@ -17,6 +24,48 @@ namespace phy {
         }
     };
 
+    // A convex shape seen only through its support mapping: a convex set of world-space
+    // points (the core) inflated by radius. A circle is one point plus its radius, a
+    // capsule two points, a polygon its vertices with radius 0.
+    struct convexShape {
+        std::span<const vec2> points;
+        float radius = 0;
+
+        // core point furthest along d
+        vec2 support(const vec2& d) const {
+            size_t best = 0;
+            float bestDot = points[0].x * d.x + points[0].y * d.y;
+            for(size_t i = 1; i < points.size(); i++) {
+                const float dot = points[i].x * d.x + points[i].y * d.y;
+                if(dot > bestDot) {
+                    bestDot = dot;
+                    best = i;
+                }
+            }
+            return points[best];
+        }
+    };
+
+    struct contactInfo {
+        vec2 normal;            // unit, pointing from shape a towards shape b
+        float depth = 0;        // penetration depth; when apart, minus the gap
+        vec2 pointA, pointB;    // witness points on the surfaces of a and b
+    };
+
+    struct contactPoint {
+        vec2 point;             // halfway between the two surfaces
+        float depth = 0;
+        std::uint32_t id = 0;   // which features touch here; stable while the pair keeps its contact
+        float normalImpulse = 0, tangentImpulse = 0;    // accumulated by the solver
+    };
+
+    // Up to two contact points sharing one normal, pointing from shape a towards shape b
+    struct manifold {
+        vec2 normal;
+        std::array<contactPoint, 2> points;
+        int count = 0;
+    };
+
     struct collision {
 
         static bool lineToLineIntersect(const vec2& l1, const vec2& l2, const vec2& l3, const vec2& l4, collisionInfo& info)
@@ -37,6 +86,380 @@ namespace phy {
             return false;
         }
 
+        // Pushes two overlapping circles apart by half the overlap each and exchanges
+        // their velocities along the centre line as an elastic collision of masses m1
+        // and m2; tangential velocities are kept. Returns false if they do not overlap.
+        static bool circleToCircle(vec2& p1, vec2& v1, const float& r1, const float& m1, vec2& p2, vec2& v2, const float& r2, const float& m2)
+        {
+            vec2 dist = p2 - p1;
+            const float maxRadius = r1 + r2;
+            const float dl = dist.length();
+            if(dl >= maxRadius) return false;
+
+            const vec2 normal = dist.normalize();
+            const vec2 displ = normal * ((maxRadius - dl) * 0.5f);
+            p1 -= displ;
+            p2 += displ;
+
+            const float u1 = dot(v1, normal), u2 = dot(v2, normal);
+            const float w1 = ((m1 - m2) * u1 + 2 * m2 * u2) / (m1 + m2);
+            const float w2 = ((m2 - m1) * u2 + 2 * m1 * u1) / (m1 + m2);
+            v1 += normal * (w1 - u1);
+            v2 += normal * (w2 - u2);
+            return true;
+        }
+
+        // GJK on the cores of a and b, falling back to EPA when the cores overlap.
+        // Returns true if the shapes touch or overlap; contact is filled either way,
+        // with depth < 0 giving the distance between separated shapes.
+        static bool gjk(const convexShape& a, const convexShape& b, contactInfo& contact)
+        {
+            contact = contactInfo{};
+            if(a.points.empty() || b.points.empty()) return false;
+
+            // vertices of the Minkowski difference a - b, with the support points that made them
+            std::array<simplexVertex, 3> simplex;
+            int count = 1;
+            simplex[0] = supportOf(a, b, b.points[0] - a.points[0]);
+
+            vec2 closest = simplex[0].w;
+            bool overlapping = false;
+            for(int iteration = 0; iteration < maxIterations; iteration++) {
+                closest = solveSimplex(simplex, count);
+                if(count == 3 || dot(closest, closest) < epsilon * epsilon) {
+                    overlapping = true;
+                    break;
+                }
+
+                const vec2 d = closest * -1.0f;
+                const simplexVertex next = supportOf(a, b, d);
+
+                // no progress towards the origin: closest is as good as it gets
+                bool duplicate = false;
+                for(int i = 0; i < count; i++) duplicate |= same(next.a, simplex[i].a) && same(next.b, simplex[i].b);
+                if(duplicate || dot(next.w, d) - dot(closest, d) <= epsilon * std::sqrt(dot(d, d))) break;
+
+                simplex[count++] = next;
+            }
+
+            const float radii = a.radius + b.radius;
+
+            if(!overlapping) {
+                vec2 pa{ 0, 0 }, pb{ 0, 0 };
+                for(int i = 0; i < count; i++) {
+                    pa += simplex[i].a * simplex[i].u;
+                    pb += simplex[i].b * simplex[i].u;
+                }
+                const vec2 delta = pb - pa;
+                const float distance = std::sqrt(dot(delta, delta));
+                contact.normal = delta * (1.0f / distance);
+                contact.depth = radii - distance;
+                contact.pointA = pa + contact.normal * a.radius;
+                contact.pointB = pb - contact.normal * b.radius;
+                return contact.depth >= 0;
+            }
+
+            epa(a, b, simplex, count, contact);
+            contact.depth += radii;
+            contact.pointA += contact.normal * a.radius;
+            contact.pointB -= contact.normal * b.radius;
+            return true;
+        }
+
+        // Contact manifold of two convex polygons given as world-space vertices, either
+        // winding. A two-point span is a two-sided segment. The face of least penetration
+        // is the reference; the most opposed face of the other polygon is clipped against
+        // its side planes, and the clipped points behind the reference face are the contacts.
+        // Impulses are left at zero for a ManifoldCache to fill in.
+        static bool polygonManifold(std::span<const vec2> a, std::span<const vec2> b, manifold& m)
+        {
+            m = manifold{};
+            if(a.size() < 2 || b.size() < 2) return false;
+
+            const float windingA = winding(a), windingB = winding(b);
+            const auto [edgeA, separationA] = maxSeparation(a, windingA, b);
+            if(separationA > 0) return false;
+            const auto [edgeB, separationB] = maxSeparation(b, windingB, a);
+            if(separationB > 0) return false;
+
+            // a wins near-ties, so the reference face does not flicker from frame to frame
+            const bool flip = separationB > relativeTolerance * separationA + absoluteTolerance;
+            const std::span<const vec2> ref = flip ? b : a, inc = flip ? a : b;
+            const size_t refEdge = flip ? edgeB : edgeA;
+            const float refWinding = flip ? windingB : windingA, incWinding = flip ? windingA : windingB;
+            const vec2 n = edgeNormal(ref, refWinding, refEdge);
+
+            size_t incEdge = 0;
+            float minDot = INFINITY;
+            for(size_t i = 0; i < inc.size(); i++) {
+                const float d = dot(edgeNormal(inc, incWinding, i), n);
+                if(d < minDot) {
+                    minDot = d;
+                    incEdge = i;
+                }
+            }
+
+            const size_t inc1 = incEdge, inc2 = (incEdge + 1) % inc.size();
+            const size_t ref1 = refEdge, ref2 = (refEdge + 1) % ref.size();
+            const vec2 v1 = ref[ref1], v2 = ref[ref2];
+            vec2 tangent = v2 - v1;
+            const float length = std::sqrt(dot(tangent, tangent));
+            if(length < epsilon) return false;
+            tangent *= 1.0f / length;
+
+            const std::array<clipVertex, 2> incident{ {
+                { inc[inc1], static_cast<std::uint32_t>(inc1) },
+                { inc[inc2], static_cast<std::uint32_t>(inc2) }
+            } };
+            std::array<clipVertex, 2> sideClipped, clipped;
+            if(clipSegment(sideClipped, incident, tangent * -1.0f, -dot(tangent, v1), clippedFeature | static_cast<std::uint32_t>(ref1 & featureMask)) < 2) return false;
+            if(clipSegment(clipped, sideClipped, tangent, dot(tangent, v2), clippedFeature | static_cast<std::uint32_t>(ref2 & featureMask)) < 2) return false;
+
+            const std::uint32_t base = (flip ? flipFeature : 0) | (static_cast<std::uint32_t>(refEdge & featureMask) << 16);
+            const float front = dot(n, v1);
+            m.normal = flip ? n * -1.0f : n;
+            for(const clipVertex& v: clipped) {
+                const float separation = dot(n, v.p) - front;
+                if(separation > 0) continue;
+
+                contactPoint& cp = m.points[m.count++];
+                cp.point = v.p - n * (separation * 0.5f);
+                cp.depth = -separation;
+                cp.id = base | (v.feature & (clippedFeature | featureMask));
+            }
+            return m.count > 0;
+        }
+
+        private:
+        static constexpr int maxIterations = 32;
+        static constexpr int maxPolytope = 64;
+        static constexpr float epsilon = 1e-5f;
+        static constexpr float relativeTolerance = 0.98f;
+        static constexpr float absoluteTolerance = 0.001f;
+
+        // contactPoint::id: flip | reference edge << 16 | clipped | vertex. An unclipped point
+        // is named by its incident vertex, a clipped one by the reference vertex that cut it.
+        static constexpr std::uint32_t flipFeature = 1u << 31;
+        static constexpr std::uint32_t clippedFeature = 1u << 15;
+        static constexpr std::uint32_t featureMask = 0x7FFF;
+
+        struct clipVertex {
+            vec2 p;
+            std::uint32_t feature = 0;
+        };
+
+        struct simplexVertex {
+            vec2 a, b, w;       // w = a - b
+            float u = 1;        // barycentric weight of the closest point
+        };
+
+        static float dot(const vec2& p, const vec2& q) {
+            return p.x * q.x + p.y * q.y;
+        }
+
+        static float cross(const vec2& p, const vec2& q) {
+            return p.x * q.y - p.y * q.x;
+        }
+
+        static bool same(const vec2& p, const vec2& q) {
+            return p.x == q.x && p.y == q.y;
+        }
+
+        static simplexVertex supportOf(const convexShape& a, const convexShape& b, const vec2& d) {
+            const vec2 pa = a.support(d);
+            const vec2 pb = b.support(d * -1.0f);
+            return simplexVertex{ pa, pb, pa - pb, 1 };
+        }
+
+        // Reduces the simplex to the feature closest to the origin and returns the closest
+        // point. Leaves all three vertices when the origin is inside the triangle.
+        static vec2 solveSimplex(std::array<simplexVertex, 3>& s, int& count) {
+            if(count == 1) {
+                s[0].u = 1;
+                return s[0].w;
+            }
+
+            if(count == 2) {
+                const vec2 e = s[1].w - s[0].w;
+                const float d1 = dot(s[1].w, e), d2 = -dot(s[0].w, e);
+                if(d2 <= 0) {
+                    count = 1;
+                    s[0].u = 1;
+                    return s[0].w;
+                }
+                if(d1 <= 0) {
+                    s[0] = s[1];
+                    count = 1;
+                    s[0].u = 1;
+                    return s[0].w;
+                }
+                return keepEdge(s, count, 0, 1, d1, d2);
+            }
+
+            const vec2 w1 = s[0].w, w2 = s[1].w, w3 = s[2].w;
+            const vec2 e12 = w2 - w1, e13 = w3 - w1, e23 = w3 - w2;
+            const float d12_1 = dot(w2, e12), d12_2 = -dot(w1, e12);
+            const float d13_1 = dot(w3, e13), d13_2 = -dot(w1, e13);
+            const float d23_1 = dot(w3, e23), d23_2 = -dot(w2, e23);
+
+            const float n123 = cross(e12, e13);
+            const float d123_1 = n123 * cross(w2, w3);
+            const float d123_2 = n123 * cross(w3, w1);
+            const float d123_3 = n123 * cross(w1, w2);
+
+            if(d12_2 <= 0 && d13_2 <= 0) return keepVertex(s, count, 0);
+            if(d12_1 > 0 && d12_2 > 0 && d123_3 <= 0) return keepEdge(s, count, 0, 1, d12_1, d12_2);
+            if(d13_1 > 0 && d13_2 > 0 && d123_2 <= 0) return keepEdge(s, count, 0, 2, d13_1, d13_2);
+            if(d12_1 <= 0 && d23_2 <= 0) return keepVertex(s, count, 1);
+            if(d13_1 <= 0 && d23_1 <= 0) return keepVertex(s, count, 2);
+            if(d23_1 > 0 && d23_2 > 0 && d123_1 <= 0) return keepEdge(s, count, 1, 2, d23_1, d23_2);
+
+            const float inv = 1.0f / (d123_1 + d123_2 + d123_3);
+            s[0].u = d123_1 * inv;
+            s[1].u = d123_2 * inv;
+            s[2].u = d123_3 * inv;
+            return { 0, 0 };
+        }
+
+        static vec2 keepVertex(std::array<simplexVertex, 3>& s, int& count, const int& i) {
+            s[0] = s[i];
+            s[0].u = 1;
+            count = 1;
+            return s[0].w;
+        }
+
+        // d1 and d2 are the unnormalised weights of vertex i and vertex j
+        static vec2 keepEdge(std::array<simplexVertex, 3>& s, int& count, const int& i, const int& j, const float& d1, const float& d2) {
+            const simplexVertex vi = s[i], vj = s[j];
+            const float inv = 1.0f / (d1 + d2);
+            s[0] = vi;
+            s[1] = vj;
+            s[0].u = d1 * inv;
+            s[1].u = d2 * inv;
+            count = 2;
+            return s[0].w * s[0].u + s[1].w * s[1].u;
+        }
+
+        // 1 for a counter-clockwise polygon (y up), -1 for clockwise; 1 for a segment
+        static float winding(std::span<const vec2> points) {
+            float area = 0;
+            for(size_t i = 0; i < points.size(); i++)
+                area += cross(points[i], points[(i + 1) % points.size()]);
+            return area < 0 ? -1.0f : 1.0f;
+        }
+
+        static vec2 edgeNormal(std::span<const vec2> points, const float& winding, const size_t& i) {
+            const vec2 e = points[(i + 1) % points.size()] - points[i];
+            const float length = std::sqrt(dot(e, e));
+            if(length < epsilon) return { 0, 0 };
+            return vec2{ e.y, -e.x } * (winding / length);
+        }
+
+        // the edge of a that b sits furthest out of, and how far (negative when penetrating)
+        static std::pair<size_t, float> maxSeparation(std::span<const vec2> a, const float& windingA, std::span<const vec2> b) {
+            size_t best = 0;
+            float bestSeparation = -INFINITY;
+            for(size_t i = 0; i < a.size(); i++) {
+                const vec2 n = edgeNormal(a, windingA, i);
+                if(n.x == 0 && n.y == 0) continue;
+
+                float separation = INFINITY;
+                for(const vec2& v: b) separation = std::min(separation, dot(n, v - a[i]));
+                if(separation > bestSeparation) {
+                    bestSeparation = separation;
+                    best = i;
+                }
+            }
+            return { best, bestSeparation };
+        }
+
+        // keeps the part of the segment in with dot(n, p) <= offset
+        static int clipSegment(std::array<clipVertex, 2>& out, const std::array<clipVertex, 2>& in, const vec2& n, const float& offset, const std::uint32_t& feature) {
+            int count = 0;
+            const float d0 = dot(n, in[0].p) - offset, d1 = dot(n, in[1].p) - offset;
+            if(d0 <= 0) out[count++] = in[0];
+            if(d1 <= 0) out[count++] = in[1];
+            if(d0 * d1 < 0) {
+                const float t = d0 / (d0 - d1);
+                out[count++] = { in[0].p + (in[1].p - in[0].p) * t, feature };
+            }
+            return count;
+        }
+
+        // Expanding polytope: grows the simplex towards the boundary of a - b until the
+        // face nearest the origin stops moving. Fills normal, depth (of the cores) and
+        // the core witness points.
+        static void epa(const convexShape& a, const convexShape& b, const std::array<simplexVertex, 3>& simplex, int count, contactInfo& contact) {
+            std::array<simplexVertex, maxPolytope> poly;
+            for(int i = 0; i < count; i++) poly[i] = simplex[i];
+
+            // the cores only touch at a point or along a segment: open a triangle around it
+            const vec2 axes[4] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
+            for(int k = 0; count < 3 && k < 4; k++) {
+                vec2 dir = axes[k];
+                if(count == 2) {
+                    const vec2 e = poly[1].w - poly[0].w;
+                    dir = k % 2 == 0 ? vec2{ -e.y, e.x } : vec2{ e.y, -e.x };
+                }
+                const simplexVertex v = supportOf(a, b, dir);
+                bool fresh = true;
+                for(int i = 0; i < count; i++) fresh &= !same(v.w, poly[i].w);
+                if(count == 2 && std::abs(cross(poly[1].w - poly[0].w, v.w - poly[0].w)) < epsilon) fresh = false;
+                if(fresh) poly[count++] = v;
+            }
+
+            if(count < 3) {
+                // both cores are single points in the same place
+                contact.normal = { 0, -1 };
+                contact.depth = 0;
+                contact.pointA = poly[0].a;
+                contact.pointB = poly[0].b;
+                return;
+            }
+
+            // counter-clockwise, so (e.y, -e.x) is every edge's outward normal
+            if(cross(poly[1].w - poly[0].w, poly[2].w - poly[0].w) < 0) std::swap(poly[1], poly[2]);
+
+            int edge = 0;
+            vec2 normal{ 0, -1 };
+            float distance = 0;
+            for(int iteration = 0; iteration < maxIterations; iteration++) {
+                distance = INFINITY;
+                for(int i = 0; i < count; i++) {
+                    const vec2 e = poly[(i + 1) % count].w - poly[i].w;
+                    const float length = std::sqrt(dot(e, e));
+                    if(length < epsilon) continue;
+
+                    const vec2 n{ e.y / length, -e.x / length };
+                    const float d = dot(n, poly[i].w);
+                    if(d < distance) {
+                        distance = d;
+                        normal = n;
+                        edge = i;
+                    }
+                }
+
+                const simplexVertex v = supportOf(a, b, normal);
+                if(dot(v.w, normal) - distance < epsilon * std::max(1.0f, distance) || count == maxPolytope) break;
+
+                for(int i = count; i > edge + 1; i--) poly[i] = poly[i - 1];
+                poly[edge + 1] = v;
+                count++;
+            }
+
+            // where the origin projects onto the closest edge
+            const simplexVertex& v0 = poly[edge];
+            const simplexVertex& v1 = poly[(edge + 1) % count];
+            const vec2 e = v1.w - v0.w;
+            const float lengthSq = dot(e, e);
+            const float t = lengthSq > 0 ? std::clamp(-dot(v0.w, e) / lengthSq, 0.0f, 1.0f) : 0.0f;
+
+            contact.normal = normal;
+            contact.depth = distance;
+            contact.pointA = v0.a + (v1.a - v0.a) * t;
+            contact.pointB = v0.b + (v1.b - v0.b) * t;
+        }
+
     };
 
     
@@ -0,0 +1,118 @@
+#ifndef __PHY_CONSTRAINT_GRAPH_H__
+#define __PHY_CONSTRAINT_GRAPH_H__
+
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <utility>
+#include <bit>
+#include <algorithm>
+
+#include "threadpool.h"
+
+namespace phy {
+
+    // Splits two-particle constraints (sticks, springs) into colors so that no two
+    // constraints of one color share a particle. A color can then be solved in any order
+    // or in parallel without races, one color after the other. Coloring is greedy: each
+    // constraint takes the lowest color free at both ends. A particle with more than
+    // maxColors constraints spills the rest into one extra group that is solved serially.
+    class ConstraintGraph {
+
+        public:
+            using index_type = std::uint32_t;
+            using edge_type = std::pair<index_type, index_type>;
+            static constexpr size_t maxColors = 64;
+            static constexpr size_t parallelMin = 1024;    // smaller colors run on the caller
+            static constexpr size_t chunkSize = 256;
+
+        private:
+            std::vector<index_type> order;          // constraint indices grouped by color
+            std::vector<size_t> offsets;            // color c is order[offsets[c], offsets[c + 1])
+            std::vector<std::uint64_t> used;        // colors taken at each particle
+            size_t overflow = 0;                    // size of the serial group at the end of order
+
+        public:
+
+            ConstraintGraph() = default;
+
+            void build(std::span<const edge_type> edges, const size_t& particleCount)
+            {
+                used.assign(particleCount, 0);
+                std::vector<std::uint8_t> colors(edges.size());
+                std::vector<size_t> counts(maxColors + 1, 0);
+
+                for(size_t i = 0; i < edges.size(); i++) {
+                    const auto [a, b] = edges[i];
+                    const std::uint64_t taken = used[a] | used[b];
+                    const size_t color = taken == ~std::uint64_t(0) ? maxColors : std::countr_one(taken);
+                    if(color < maxColors) {
+                        used[a] |= std::uint64_t(1) << color;
+                        used[b] |= std::uint64_t(1) << color;
+                    }
+                    colors[i] = static_cast<std::uint8_t>(color);
+                    counts[color]++;
+                }
+
+                // counting sort by color, overflow group last
+                size_t colorCount = 0;
+                for(size_t c = 0; c < maxColors; c++) if(counts[c]) colorCount = c + 1;
+                offsets.assign(colorCount + 1, 0);
+                std::vector<size_t> cursor(maxColors + 1, 0);
+                size_t total = 0;
+                for(size_t c = 0; c <= maxColors; c++) {
+                    cursor[c] = total;
+                    if(c < colorCount) offsets[c] = total;
+                    total += counts[c];
+                }
+                offsets[colorCount] = total - counts[maxColors];
+                overflow = counts[maxColors];
+
+                order.resize(edges.size());
+                for(size_t i = 0; i < edges.size(); i++)
+                    order[cursor[colors[i]]++] = static_cast<index_type>(i);
+            }
+
+            size_t colorCount() const {
+                return offsets.empty() ? 0 : offsets.size() - 1;
+            }
+
+            // constraint indices of color c
+            std::span<const index_type> getColor(const size_t& c) const {
+                return std::span<const index_type>(order).subspan(offsets[c], offsets[c + 1] - offsets[c]);
+            }
+
+            // constraints that did not fit in maxColors
+            std::span<const index_type> getOverflow() const {
+                return std::span<const index_type>(order).subspan(order.size() - overflow);
+            }
+
+            // Calls fn(constraintIndex) for every constraint, color by color. Colors with
+            // at least parallelMin constraints are spread over pool in chunks.
+            template<typename F>
+            void solve(F&& fn, ThreadPool* pool = nullptr) const
+            {
+                for(size_t c = 0; c < colorCount(); c++) {
+                    const std::span<const index_type> color = getColor(c);
+                    if(!pool || pool->size() == 1 || color.size() < parallelMin) {
+                        for(const index_type& i: color) fn(i);
+                        continue;
+                    }
+
+                    pool->parallelFor((color.size() + chunkSize - 1) / chunkSize, [&](const size_t& chunk) {
+                        const size_t end = std::min(color.size(), (chunk + 1) * chunkSize);
+                        for(size_t i = chunk * chunkSize; i < end; i++) fn(color[i]);
+                    });
+                }
+
+                for(const index_type& i: getOverflow()) fn(i);
+            }
+
+            size_t size() const {
+                return order.size();
+            }
+    };
+
+}
+
+#endif
@@ -0,0 +1,210 @@
+#ifndef __PHY_CONTACT_SOLVER_H__
+#define __PHY_CONTACT_SOLVER_H__
+
+#include <vector>
+#include <span>
+#include <array>
+#include <cstdint>
+#include <algorithm>
+
+#include "vec2.h"
+#include "collision.h"
+
+namespace phy {
+
+    // What the solver needs of a body. Static bodies have zero inverse mass and inertia.
+    struct solverBody {
+        vec2 pos, vel;
+        float angVelo = 0;
+        float invMass = 0, invInertia = 0;
+    };
+
+    struct solverSettings {
+        int iterations = 8;
+        float baumgarte = 0.2f;         // share of the penetration fed back per step
+        float slop = 0.5f;              // penetration left alone, keeps resting contacts touching
+        float friction = 0.4f;
+        float restitution = 0;
+        float restitutionThreshold = 1; // slower approaches don't bounce
+        bool warmStarting = true;
+    };
+
+    // Sequential-impulse contact solver. Contacts for a step are collected with add(),
+    // then solve() computes the effective masses and Baumgarte bias of every point once,
+    // applies last step's impulses (warm starting), and runs a fixed number of passes,
+    // clamping the accumulated normal impulse to >= 0 and friction to the Coulomb cone.
+    // The accumulated impulses are written back into the manifolds, so manifolds that
+    // live in a ManifoldCache start the next step where this one ended.
+    class ContactSolver {
+
+        public:
+            using index_type = std::uint32_t;
+
+        private:
+            struct Point {
+                vec2 rA, rB;
+                float normalMass = 0, tangentMass = 0;
+                float bias = 0;
+                float normalImpulse = 0, tangentImpulse = 0;
+            };
+
+            struct Constraint {
+                index_type a = 0, b = 0;
+                manifold* contact = nullptr;
+                vec2 normal, tangent;
+                float friction = 0, restitution = 0;
+                std::array<Point, 2> points;
+                int count = 0;
+            };
+
+            std::vector<Constraint> constraints;
+            solverSettings settings;
+
+        public:
+
+            ContactSolver() = default;
+
+            explicit ContactSolver(const solverSettings& s): settings(s) {}
+
+            solverSettings& getSettings() {
+                return settings;
+            }
+
+            void clear() {
+                constraints.clear();
+            }
+
+            // m must stay alive until solve() returns; its points' impulses are updated
+            void add(const index_type& a, const index_type& b, manifold& m)
+            {
+                if(m.count == 0) return;
+                Constraint& c = constraints.emplace_back();
+                c.a = a;
+                c.b = b;
+                c.contact = &m;
+                c.normal = m.normal;
+                c.tangent = { -m.normal.y, m.normal.x };
+                c.friction = settings.friction;
+                c.restitution = settings.restitution;
+                c.count = m.count;
+            }
+
+            size_t size() const {
+                return constraints.size();
+            }
+
+            // Solves every added contact against bodies and clears the batch
+            void solve(std::span<solverBody> bodies, const float& dt)
+            {
+                if(dt <= 0) {
+                    constraints.clear();
+                    return;
+                }
+
+                for(Constraint& c: constraints) prepare(bodies, c, dt);
+                if(settings.warmStarting)
+                    for(Constraint& c: constraints) warmStart(bodies, c);
+
+                for(int iteration = 0; iteration < settings.iterations; iteration++)
+                    for(Constraint& c: constraints) solveConstraint(bodies, c);
+
+                for(Constraint& c: constraints) {
+                    for(int i = 0; i < c.count; i++) {
+                        c.contact->points[i].normalImpulse = c.points[i].normalImpulse;
+                        c.contact->points[i].tangentImpulse = c.points[i].tangentImpulse;
+                    }
+                }
+                constraints.clear();
+            }
+
+        private:
+            static float cross(const vec2& p, const vec2& q) {
+                return p.x * q.y - p.y * q.x;
+            }
+
+            static float dot(const vec2& p, const vec2& q) {
+                return p.x * q.x + p.y * q.y;
+            }
+
+            // velocity of b relative to a at the contact point
+            static vec2 relativeVelocity(const solverBody& a, const solverBody& b, const Point& p) {
+                const vec2 va = a.vel + vec2{ -a.angVelo * p.rA.y, a.angVelo * p.rA.x };
+                const vec2 vb = b.vel + vec2{ -b.angVelo * p.rB.y, b.angVelo * p.rB.x };
+                return vb - va;
+            }
+
+            static void applyImpulse(solverBody& a, solverBody& b, const Point& p, const vec2& impulse) {
+                a.vel -= impulse * a.invMass;
+                a.angVelo -= cross(p.rA, impulse) * a.invInertia;
+                b.vel += impulse * b.invMass;
+                b.angVelo += cross(p.rB, impulse) * b.invInertia;
+            }
+
+            void prepare(std::span<solverBody> bodies, Constraint& c, const float& dt) const
+            {
+                const solverBody& a = bodies[c.a];
+                const solverBody& b = bodies[c.b];
+                const float invMass = a.invMass + b.invMass;
+
+                for(int i = 0; i < c.count; i++) {
+                    const contactPoint& cp = c.contact->points[i];
+                    Point& p = c.points[i];
+                    p.rA = cp.point - a.pos;
+                    p.rB = cp.point - b.pos;
+
+                    const float rnA = cross(p.rA, c.normal), rnB = cross(p.rB, c.normal);
+                    const float kNormal = invMass + a.invInertia * rnA * rnA + b.invInertia * rnB * rnB;
+                    p.normalMass = kNormal > 0 ? 1.0f / kNormal : 0;
+
+                    const float rtA = cross(p.rA, c.tangent), rtB = cross(p.rB, c.tangent);
+                    const float kTangent = invMass + a.invInertia * rtA * rtA + b.invInertia * rtB * rtB;
+                    p.tangentMass = kTangent > 0 ? 1.0f / kTangent : 0;
+
+                    p.bias = settings.baumgarte / dt * std::max(0.0f, cp.depth - settings.slop);
+                    const float vn = dot(relativeVelocity(a, b, p), c.normal);
+                    if(vn < -settings.restitutionThreshold) p.bias = std::max(p.bias, -c.restitution * vn);
+
+                    p.normalImpulse = settings.warmStarting ? cp.normalImpulse : 0;
+                    p.tangentImpulse = settings.warmStarting ? cp.tangentImpulse : 0;
+                }
+            }
+
+            static void warmStart(std::span<solverBody> bodies, Constraint& c)
+            {
+                solverBody& a = bodies[c.a];
+                solverBody& b = bodies[c.b];
+                for(int i = 0; i < c.count; i++) {
+                    const Point& p = c.points[i];
+                    applyImpulse(a, b, p, c.normal * p.normalImpulse + c.tangent * p.tangentImpulse);
+                }
+            }
+
+            static void solveConstraint(std::span<solverBody> bodies, Constraint& c)
+            {
+                solverBody& a = bodies[c.a];
+                solverBody& b = bodies[c.b];
+
+                // friction first, so the normal impulse has the last word on penetration
+                for(int i = 0; i < c.count; i++) {
+                    Point& p = c.points[i];
+                    const float vt = dot(relativeVelocity(a, b, p), c.tangent);
+                    const float limit = c.friction * p.normalImpulse;
+                    const float total = std::clamp(p.tangentImpulse - vt * p.tangentMass, -limit, limit);
+                    applyImpulse(a, b, p, c.tangent * (total - p.tangentImpulse));
+                    p.tangentImpulse = total;
+                }
+
+                for(int i = 0; i < c.count; i++) {
+                    Point& p = c.points[i];
+                    // the normal points from a to b, so approaching means vn < 0
+                    const float vn = dot(relativeVelocity(a, b, p), c.normal);
+                    const float total = std::max(p.normalImpulse - (vn - p.bias) * p.normalMass, 0.0f);
+                    applyImpulse(a, b, p, c.normal * (total - p.normalImpulse));
+                    p.normalImpulse = total;
+                }
+            }
+    };
+
+}
+
+#endif
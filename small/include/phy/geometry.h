@@ -1,6 +1,8 @@
 #ifndef __PHY_GEOMETRY_H__
 #define __PHY_GEOMETRY_H__
 
+#include <cmath>
+
 #include "vec2.h"
 
 namespace phy {
@@ -27,6 +29,12 @@ namespace phy {
         }
     };
 
+    // points along the ray are origin + dir * t for t in [0, maxT)
+    struct Ray2D {
+        vec2 origin, dir;
+        float maxT = INFINITY;
+    };
+
 }
 
 #endif 
\ No newline at end of file
@@ -0,0 +1,65 @@
+#ifndef __PHY_HEADLESS_H__
+#define __PHY_HEADLESS_H__
+
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "profiler.h"
+
+namespace phy {
+
+    // whether flag (e.g. "--trace") is on the command line
+    inline bool hasFlag(int argc, char** argv, std::string_view flag)
+    {
+        for(int i = 1; i < argc; i++)
+            if(argv[i] == flag) return true;
+        return false;
+    }
+
+    // Number of ticks asked for with `--headless [ticks]`, or 0 for a normal windowed run
+    inline int headlessTicks(int argc, char** argv, const int& defaultTicks = 10000)
+    {
+        for(int i = 1; i < argc; i++) {
+            if(std::string_view(argv[i]) != "--headless") continue;
+            if(i + 1 < argc) {
+                const int ticks = std::atoi(argv[i + 1]);
+                if(ticks > 0) return ticks;
+            }
+            return defaultTicks;
+        }
+        return 0;
+    }
+
+    // Steps a world ticks times with a fixed dt and no window or renderer, then prints
+    // ticks per second and the time per PHY_ZONE, and writes the zones to
+    // <name>.trace.json. The zones need PHY_PROFILE; the headless target in small/
+    // builds profiled copies of the demos for this. Returns 0 so main can return it.
+    template<typename F>
+    int runHeadless(const char* name, const int& ticks, const float& dt, F&& step)
+    {
+        Profiler::clear();
+        const auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < ticks; i++) step(dt);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::printf("%s: %d ticks of %.4f s in %.3f s, %.0f ticks/s\n", name, ticks, dt, seconds, ticks / seconds);
+#if defined(PHY_PROFILE)
+        for(const auto& [zone, ms, count]: Profiler::totals()) {
+            std::printf("  %-14s %9.3f ms  %5.1f%%  %8.2f us/tick\n",
+                zone.c_str(), ms, seconds > 0 ? ms / (10 * seconds) : 0.0, ms * 1e3 / ticks);
+        }
+        const std::string trace = std::string(name) + ".trace.json";
+        if(Profiler::writeChromeTrace(trace)) std::printf("  trace written to %s\n", trace.c_str());
+#else
+        std::fflush(stdout);
+        std::fprintf(stderr, "  no per-phase timings: built without PHY_PROFILE (use the headless target)\n");
+#endif
+        return 0;
+    }
+
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef __PHY_INTEGRATOR_H__
+#define __PHY_INTEGRATOR_H__
+
+#include "vec2.h"
+
+namespace phy {
+
+    struct integrator {
+
+        // One classic Runge-Kutta step of pos' = vel, vel' = acceleration(pos, vel)
+        template<typename F>
+        static void rk4(vec2& pos, vec2& vel, const float& dt, F&& acceleration)
+        {
+            const float half = dt * 0.5f;
+            const vec2 p1 = pos, v1 = vel;
+            const vec2 a1 = acceleration(p1, v1);
+            const vec2 p2 = p1 + v1 * half, v2 = v1 + a1 * half;
+            const vec2 a2 = acceleration(p2, v2);
+            const vec2 p3 = p1 + v2 * half, v3 = v1 + a2 * half;
+            const vec2 a3 = acceleration(p3, v3);
+            const vec2 p4 = p1 + v3 * dt, v4 = v1 + a3 * dt;
+            const vec2 a4 = acceleration(p4, v4);
+
+            pos += (v1 + v2 * 2.0f + v3 * 2.0f + v4) * (dt / 6.0f);
+            vel += (a1 + a2 * 2.0f + a3 * 2.0f + a4) * (dt / 6.0f);
+        }
+    };
+
+}
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef __PHY_ISLANDS_H__
+#define __PHY_ISLANDS_H__
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+
+namespace phy {
+
+    // Groups bodies into islands (bodies linked by contacts, through union-find) and puts
+    // an island to sleep once every body in it has rested for timeToSleep. Sleeping bodies
+    // are left out of integration, broadphase and narrowphase by the caller; a contact
+    // with an awake body wakes their whole island again.
+    //
+    // Per step: addContact() for every touching pair that involves an awake body, then
+    // update() after integration. Static bodies never join an island, so a floor does
+    // not glue everything resting on it into one.
+    class Islands {
+
+        public:
+            using index_type = std::uint32_t;
+            static constexpr index_type npos = ~index_type(0);
+
+        private:
+            std::vector<index_type> parent;
+            std::vector<index_type> next;       // ring through a sleeping island's bodies
+            std::vector<float> sleepTime;
+            std::vector<float> islandTime;
+            std::vector<index_type> head, tail;
+            std::vector<bool> awake, fixed;
+            size_t awakeCount = 0;
+
+        public:
+            float timeToSleep = 0.5f;
+
+            Islands() = default;
+
+            // n awake, non-static bodies
+            void resize(const size_t& n)
+            {
+                parent.resize(n);
+                next.assign(n, npos);
+                sleepTime.assign(n, 0);
+                islandTime.resize(n);
+                head.resize(n);
+                tail.resize(n);
+                awake.assign(n, true);
+                fixed.assign(n, false);
+                for(index_type i = 0; i < n; i++) parent[i] = i;
+                awakeCount = n;
+            }
+
+            void setStatic(const index_type& i, const bool& isStatic)
+            {
+                if(fixed[i] == isStatic) return;
+                fixed[i] = isStatic;
+                if(isStatic && awake[i]) awakeCount--;
+                if(!isStatic && awake[i]) awakeCount++;
+            }
+
+            // static bodies count as asleep: two of them never need a narrowphase
+            bool isAwake(const index_type& i) const {
+                return awake[i] && !fixed[i];
+            }
+
+            size_t getAwakeCount() const {
+                return awakeCount;
+            }
+
+            // Links a and b for this step and wakes either one if it was asleep
+            void addContact(const index_type& a, const index_type& b)
+            {
+                if(fixed[a] || fixed[b]) {
+                    if(!fixed[a]) wake(a);
+                    if(!fixed[b]) wake(b);
+                    return;
+                }
+                wake(a);
+                wake(b);
+
+                const index_type ra = find(a), rb = find(b);
+                if(ra != rb) parent[std::max(ra, rb)] = std::min(ra, rb);
+            }
+
+            // Wakes the whole island i belongs to
+            void wake(const index_type& i)
+            {
+                if(awake[i] || fixed[i]) return;
+                index_type body = i;
+                do {
+                    awake[body] = true;
+                    sleepTime[body] = 0;
+                    awakeCount++;
+                    const index_type following = next[body];
+                    next[body] = npos;
+                    body = following;
+                } while(body != npos && body != i);
+            }
+
+            // Advances the sleep timers of awake bodies and puts islands to sleep whose
+            // every body has rested long enough. resting(i) says whether body i moved
+            // slowly enough this step. Resets the links for the next step.
+            template<typename F>
+            void update(const float& dt, F&& resting)
+            {
+                const index_type n = static_cast<index_type>(parent.size());
+                for(index_type i = 0; i < n; i++) {
+                    if(!isAwake(i)) continue;
+                    sleepTime[i] = resting(i) ? sleepTime[i] + dt : 0;
+                    islandTime[i] = INFINITY;
+                    head[i] = tail[i] = npos;
+                }
+
+                for(index_type i = 0; i < n; i++) {
+                    if(!isAwake(i)) continue;
+                    const index_type root = find(i);
+                    islandTime[root] = std::min(islandTime[root], sleepTime[i]);
+                }
+
+                for(index_type i = 0; i < n; i++) {
+                    if(!isAwake(i)) continue;
+                    const index_type root = find(i);
+                    if(islandTime[root] < timeToSleep) continue;
+
+                    // chain the island into a ring so wake() can find every member
+                    next[i] = head[root];
+                    head[root] = i;
+                    if(tail[root] == npos) tail[root] = i;
+                    next[tail[root]] = i;
+                }
+
+                for(index_type i = 0; i < n; i++) {
+                    if(isAwake(i) && islandTime[find(i)] >= timeToSleep) {
+                        awake[i] = false;
+                        awakeCount--;
+                    }
+                }
+
+                for(index_type i = 0; i < n; i++) parent[i] = i;
+            }
+
+            size_t size() const {
+                return parent.size();
+            }
+
+            // the root body of i's island as linked this step
+            index_type getIsland(const index_type& i) {
+                return find(i);
+            }
+
+        private:
+            index_type find(index_type i) {
+                while(parent[i] != i) {
+                    parent[i] = parent[parent[i]];
+                    i = parent[i];
+                }
+                return i;
+            }
+    };
+
+}
+
+#endif
@@ -0,0 +1,258 @@
+#ifndef __PHY_LINEAR_QUADTREE_H__
+#define __PHY_LINEAR_QUADTREE_H__
+
+#include <vector>
+#include <span>
+#include <array>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+#include <bit>
+#include <utility>
+#include <type_traits>
+
+#include "vec2.h"
+#include "geometry.h"
+
+namespace phy {
+
+    // Pointerless quadtree. The boundary is cut into a 2^d x 2^d grid and every object
+    // is tagged with the smallest cell that holds it: the cell's Morton (Z-order) code,
+    // padded to the finest level, with the cell's level in the low bits. Objects are
+    // kept in one array sorted by that key, so a cell and everything below it is one
+    // contiguous key interval. A query walks the implicit cells that touch the range
+    // and turns each into two binary searches. A subtree that lies inside the range,
+    // or holds only a few objects (capacity, but at least 32), is scanned straight
+    // through instead.
+    //
+    // Same resize()/insert()/getRange()/query() surface as Quadtree<T>, aimed at trees
+    // rebuilt every frame. There is no update()/remove(); after inserts, the first query
+    // sorts the array, so insert and query from one thread at a time.
+    template<RectangularObjectConcept T>
+    class LinearQuadtree {
+
+        public:
+            using index_type = std::uint32_t;
+            using key_type = std::uint64_t;
+            static constexpr index_type maxDepth = 16;
+
+        private:
+            static constexpr key_type levelBits = 5;
+            static constexpr size_t minScan = 32;   // a short contiguous scan beats more binary searches
+
+            struct Cell {
+                index_type level, x, y;
+            };
+
+            Rect2D boundary;
+            int capacity = 4;
+            index_type depth = 0;
+            vec2 scale;                             // world units to finest-level cells
+
+            mutable std::vector<std::pair<key_type, T*>> items;
+            mutable std::vector<key_type> keys;
+            mutable std::vector<T*> objects;
+            mutable bool sorted = true;
+
+        public:
+
+            LinearQuadtree() = default;
+
+            // minArea plays the same role as in Quadtree: no cell is smaller than it
+            void resize(const Rect2D& b, const int& c, const float& minArea = 1000)
+            {
+                boundary = b;
+                capacity = c;
+
+                depth = 0;
+                for(float hw = b.size.x * 0.5f, hh = b.size.y * 0.5f; depth < maxDepth && hw * hh >= minArea; hw *= 0.5f, hh *= 0.5f)
+                    depth++;
+
+                const float cells = static_cast<float>(1u << depth);
+                scale = { b.size.x > 0 ? cells / b.size.x : 0, b.size.y > 0 ? cells / b.size.y : 0 };
+                clear();
+            }
+
+            void clear() {
+                items.clear();
+                keys.clear();
+                objects.clear();
+                sorted = true;
+            }
+
+            bool insert(T* object) {
+                if(!rectFitCompletely(object, boundary)) return false;
+                items.emplace_back(keyOf(object), object);
+                sorted = false;
+                return true;
+            }
+
+            // replaces the contents with objects; the ones outside the boundary are skipped
+            void build(std::span<T* const> input) {
+                clear();
+                for(T* object: input) insert(object);
+                sort();
+            }
+
+            void getRange(const Rect2D& range, std::vector<T*>& queried) const
+            {
+                query(range, [&](T* object) { queried.push_back(object); });
+            }
+
+            size_t getRange(const Rect2D& range, std::span<T*> out) const
+            {
+                size_t count = 0;
+                query(range, [&](T* object) {
+                    if(count < out.size()) out[count] = object;
+                    count++;
+                });
+                return count;
+            }
+
+            // Calls visitor(T*) for every object overlapping range; a visitor returning
+            // bool stops the walk by returning false.
+            template<typename F>
+            void query(const Rect2D& range, F&& visitor) const
+            {
+                if(!sorted) sort();
+                if(keys.empty()) return;
+
+                const auto [qx0, qy0] = cellCoord(range.pos);
+                const auto [qx1, qy1] = cellCoord(range.pos + range.size);
+
+                // visits objects[begin, end) and reports whether the walk should go on
+                auto scan = [&](size_t begin, const size_t& end) {
+                    for(; begin < end; begin++) {
+                        if(!rectToRectIntersect(*objects[begin], range)) continue;
+
+                        if constexpr (std::is_same_v<std::invoke_result_t<F&, T*>, bool>) {
+                            if(!visitor(objects[begin])) return false;
+                        } else {
+                            visitor(objects[begin]);
+                        }
+                    }
+                    return true;
+                };
+
+                std::array<Cell, 4 * maxDepth> stack;
+                size_t top = 0;
+                stack[top++] = Cell{ 0, 0, 0 };
+
+                while(top) {
+                    const Cell cell = stack[--top];
+                    const index_type shift = depth - cell.level;
+                    const key_type first = paddedCode(cell.x << shift, cell.y << shift);
+                    const key_type span = key_type(1) << (2 * shift);
+
+                    const size_t begin = lowerBound((first << levelBits) | cell.level);
+                    const size_t end = lowerBound((first + span) << levelBits);
+                    if(begin == end) continue;
+
+                    const bool inside = (cell.x << shift) >= qx0 && (((cell.x + 1) << shift) - 1) <= qx1
+                        && (cell.y << shift) >= qy0 && (((cell.y + 1) << shift) - 1) <= qy1;
+                    if(inside || end - begin <= scanLimit() || cell.level == depth) {
+                        if(!scan(begin, end)) return;
+                        continue;
+                    }
+
+                    // objects tagged with this very cell, then the children the range touches
+                    if(!scan(begin, lowerBound((first << levelBits) | (cell.level + 1)))) return;
+
+                    const index_type childShift = shift - 1;
+                    for(index_type c = 0; c < 4; c++) {
+                        const index_type x = cell.x * 2 + (3 - c) % 2;
+                        const index_type y = cell.y * 2 + (3 - c) / 2;
+                        if((x << childShift) > qx1 || (((x + 1) << childShift) - 1) < qx0) continue;
+                        if((y << childShift) > qy1 || (((y + 1) << childShift) - 1) < qy0) continue;
+                        stack[top++] = Cell{ cell.level + 1, x, y };
+                    }
+                }
+            }
+
+            // objects in key order, valid until the next insert
+            std::span<T* const> getObjects() const {
+                if(!sorted) sort();
+                return objects;
+            }
+
+            const Rect2D& getBoundary() const {
+                return boundary;
+            }
+
+            index_type getDepth() const {
+                return depth;
+            }
+
+            size_t size() const {
+                return items.size();
+            }
+
+        private:
+            size_t scanLimit() const {
+                return std::max(static_cast<size_t>(capacity), minScan);
+            }
+
+            void sort() const {
+                std::sort(items.begin(), items.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+                keys.resize(items.size());
+                objects.resize(items.size());
+                for(size_t i = 0; i < items.size(); i++) {
+                    keys[i] = items[i].first;
+                    objects[i] = items[i].second;
+                }
+                sorted = true;
+            }
+
+            size_t lowerBound(const key_type& key) const {
+                return std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+            }
+
+            // the smallest cell holding both corners: its level is set by the highest bit
+            // where the corners' cell coordinates differ
+            key_type keyOf(const T* object) const {
+                const auto [x0, y0] = cellCoord(object->pos);
+                const auto [x1, y1] = cellCoord(object->pos + object->size);
+
+                const index_type shift = std::bit_width((x0 ^ x1) | (y0 ^ y1));
+                const index_type level = depth - shift;
+                return (paddedCode((x0 >> shift) << shift, (y0 >> shift) << shift) << levelBits) | level;
+            }
+
+            std::pair<index_type, index_type> cellCoord(const vec2& p) const {
+                const float limit = static_cast<float>((1u << depth) - 1);
+                return {
+                    static_cast<index_type>(std::clamp(std::floor((p.x - boundary.pos.x) * scale.x), 0.0f, limit)),
+                    static_cast<index_type>(std::clamp(std::floor((p.y - boundary.pos.y) * scale.y), 0.0f, limit))
+                };
+            }
+
+            // interleaves x into the even bits and y into the odd bits
+            static key_type paddedCode(const index_type& x, const index_type& y) {
+                return spread(x) | (spread(y) << 1);
+            }
+
+            static key_type spread(key_type v) {
+                v &= 0xFFFF;
+                v = (v | (v << 8)) & 0x00FF00FF;
+                v = (v | (v << 4)) & 0x0F0F0F0F;
+                v = (v | (v << 2)) & 0x33333333;
+                v = (v | (v << 1)) & 0x55555555;
+                return v;
+            }
+
+            static constexpr bool rectFitCompletely(const T* rect, const phy::Rect2D& boundary) {
+                return rect->pos.x >= boundary.pos.x && (rect->pos.x + rect->size.x) <= boundary.pos.x + boundary.size.x
+                    && rect->pos.y >= boundary.pos.y && (rect->pos.y + rect->size.y) <= boundary.pos.y + boundary.size.y;
+            }
+
+            template<RectangularObjectConcept A, RectangularObjectConcept B>
+            static constexpr bool rectToRectIntersect(const A& a, const B& b)
+            {
+                return (a.pos.x < b.pos.x + b.size.x && a.pos.x + a.size.x > b.pos.x &&
+                    a.pos.y < b.pos.y + b.size.y && a.pos.y + a.size.y > b.pos.y);
+            }
+    };
+
+}
+
+#endif
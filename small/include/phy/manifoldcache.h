@@ -0,0 +1,103 @@
+#ifndef __PHY_MANIFOLD_CACHE_H__
+#define __PHY_MANIFOLD_CACHE_H__
+
+#include <unordered_map>
+#include <cstdint>
+
+#include "collision.h"
+
+namespace phy {
+
+    // Contact manifolds that outlive the frame, keyed by the pair of body ids. update()
+    // hands a fresh manifold the impulses its points had last frame, matched by feature
+    // id, so a solver can start from them instead of from zero. Pass a pair in the same
+    // order every frame (e.g. lower id first), or the ids and normal will not line up.
+    class ManifoldCache {
+
+        public:
+            using id_type = std::uint32_t;
+            using key_type = std::uint64_t;
+
+        private:
+            struct Entry {
+                manifold contact;
+                id_type a = 0, b = 0;
+                std::uint32_t frame = 0;
+            };
+
+            std::unordered_map<key_type, Entry> pairs;
+            std::uint32_t frame = 0;
+
+        public:
+
+            // Stores fresh for the pair, carrying impulses over from points with the same id,
+            // and returns the stored manifold for the solver to write its impulses back into.
+            manifold& update(const id_type& a, const id_type& b, const manifold& fresh)
+            {
+                auto [it, inserted] = pairs.try_emplace(keyOf(a, b));
+                Entry& entry = it->second;
+
+                manifold merged = fresh;
+                if(!inserted) {
+                    for(int i = 0; i < merged.count; i++) {
+                        contactPoint& point = merged.points[i];
+                        for(int j = 0; j < entry.contact.count; j++) {
+                            const contactPoint& old = entry.contact.points[j];
+                            if(old.id != point.id) continue;
+                            point.normalImpulse = old.normalImpulse;
+                            point.tangentImpulse = old.tangentImpulse;
+                            break;
+                        }
+                    }
+                }
+
+                entry.contact = merged;
+                entry.a = a;
+                entry.b = b;
+                entry.frame = frame;
+                return entry.contact;
+            }
+
+            manifold* find(const id_type& a, const id_type& b) {
+                auto it = pairs.find(keyOf(a, b));
+                return it == pairs.end() ? nullptr : &it->second.contact;
+            }
+
+            void remove(const id_type& a, const id_type& b) {
+                pairs.erase(keyOf(a, b));
+            }
+
+            // Drops every pair that was not updated since the last call; call once per step
+            // after the narrowphase.
+            void prune()
+            {
+                for(auto it = pairs.begin(); it != pairs.end();) {
+                    if(it->second.frame != frame) it = pairs.erase(it);
+                    else ++it;
+                }
+                frame++;
+            }
+
+            // calls visitor(a, b, manifold&) for every stored pair
+            template<typename F>
+            void forEach(F&& visitor) {
+                for(auto& [key, entry]: pairs) visitor(entry.a, entry.b, entry.contact);
+            }
+
+            size_t size() const {
+                return pairs.size();
+            }
+
+            void clear() {
+                pairs.clear();
+            }
+
+        private:
+            static key_type keyOf(const id_type& a, const id_type& b) {
+                return (static_cast<key_type>(a) << 32) | b;
+            }
+    };
+
+}
+
+#endif
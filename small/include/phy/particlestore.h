@@ -0,0 +1,111 @@
+#ifndef __PHY_PARTICLE_STORE_H__
+#define __PHY_PARTICLE_STORE_H__
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "vec2.h"
+
+namespace phy {
+
+    // Verlet particles stored as structure of arrays: one contiguous float array per
+    // field, so the per-particle passes below are plain loops over the arrays that the
+    // compiler turns into SIMD (check with -O3 -fopt-info-vec). Particles are referred
+    // to by 32-bit index; an inverse mass of 0 pins a particle in place.
+    class ParticleStore {
+
+        public:
+            using index_type = std::uint32_t;
+
+            std::vector<float> x, y;
+            std::vector<float> prevX, prevY;
+            std::vector<float> invMass;
+            std::vector<float> radius;
+
+            ParticleStore() = default;
+
+            index_type add(const vec2& pos, const float& r, const float& mass = 1.0f)
+            {
+                x.push_back(pos.x);
+                y.push_back(pos.y);
+                prevX.push_back(pos.x);
+                prevY.push_back(pos.y);
+                invMass.push_back(mass > 0 ? 1 / mass : 0);
+                radius.push_back(r);
+                return static_cast<index_type>(x.size() - 1);
+            }
+
+            void reserve(const size_t& n)
+            {
+                for(auto* field: { &x, &y, &prevX, &prevY, &invMass, &radius })
+                    field->reserve(n);
+            }
+
+            void clear()
+            {
+                for(auto* field: { &x, &y, &prevX, &prevY, &invMass, &radius })
+                    field->clear();
+            }
+
+            size_t size() const {
+                return x.size();
+            }
+
+            vec2 position(const index_type& i) const {
+                return { x[i], y[i] };
+            }
+
+            // x += (x - prevX) * damping + gravity * dt^2; pinned particles stay put
+            void integrate(const float& dt, const vec2& gravity, const float& damping)
+            {
+                float* __restrict px = x.data();
+                float* __restrict py = y.data();
+                float* __restrict qx = prevX.data();
+                float* __restrict qy = prevY.data();
+                const float* __restrict w = invMass.data();
+                const float ax = gravity.x * dt * dt, ay = gravity.y * dt * dt;
+                const size_t n = size();
+
+                for(size_t i = 0; i < n; i++) {
+                    const float free = w[i] > 0 ? 1.0f : 0.0f;
+                    const float cx = px[i], cy = py[i];
+                    px[i] = cx + free * ((cx - qx[i]) * damping + ax);
+                    py[i] = cy + free * ((cy - qy[i]) * damping + ay);
+                    qx[i] = cx;
+                    qy[i] = cy;
+                }
+            }
+
+            // Keeps particles inside [left, right] x (-inf, bottom], reflecting the velocity
+            // into the wall with friction so they slide along it
+            void constrainToBox(const float& left, const float& right, const float& bottom, const float& damping, const float& friction)
+            {
+                float* __restrict px = x.data();
+                float* __restrict py = y.data();
+                float* __restrict qx = prevX.data();
+                float* __restrict qy = prevY.data();
+                const float* __restrict r = radius.data();
+                const size_t n = size();
+
+                for(size_t i = 0; i < n; i++) {
+                    const float vx = (px[i] - qx[i]) * damping;
+                    const float vy = (py[i] - qy[i]) * damping;
+
+                    const float floor = bottom - r[i];
+                    const bool hitFloor = py[i] > floor;
+                    py[i] = hitFloor ? floor : py[i];
+                    qy[i] = hitFloor ? floor + vy * friction : qy[i];
+
+                    const float minX = left + r[i], maxX = right - r[i];
+                    const bool hitWall = px[i] < minX || px[i] > maxX;
+                    const float clamped = px[i] < minX ? minX : (px[i] > maxX ? maxX : px[i]);
+                    px[i] = clamped;
+                    qx[i] = hitWall ? clamped + vx * friction : qx[i];
+                }
+            }
+    };
+
+}
+
+#endif
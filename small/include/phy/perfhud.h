@@ -0,0 +1,179 @@
+#ifndef __PHY_PERFHUD_H__
+#define __PHY_PERFHUD_H__
+
+#include <SDL3/SDL.h>
+#include <array>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+namespace phy {
+
+    // Performance overlay: a rolling frame-time graph, FPS, the physics step time and
+    // a few named counters (bodies, pairs, ...). Everything is built into one vertex
+    // list and drawn with a single untextured SDL_RenderGeometry call, so the HUD adds
+    // one draw to the frame no matter how much it shows.
+    //
+    // Per frame: setPhysicsTime() and setCounter() whenever the values are known, then
+    // render() last, after the scene. render() also measures the frame time, as the time
+    // since the previous render(), and leaves the draw blend mode at SDL_BLENDMODE_BLEND.
+    class PerfHud {
+
+        public:
+            static constexpr size_t historySize = 120;     // frames in the graph
+            static constexpr size_t maxCounters = 8;
+
+            bool visible = true;
+
+        private:
+            struct Counter {
+                const char* label;
+                size_t value;
+            };
+
+            static constexpr float scale = 2;               // screen pixels per font pixel
+            static constexpr float lineHeight = 7 * scale;
+            static constexpr float graphHeight = 48;
+            static constexpr float graphMaxMs = 100.0f / 3; // a bar at full height is two 60 Hz frames
+            static constexpr float barWidth = 2;
+            static constexpr float padding = 6;
+
+            std::array<float, historySize> history{};
+            size_t frames = 0;
+            std::chrono::steady_clock::time_point lastFrame;
+            float physicsMs = 0;
+
+            std::array<Counter, maxCounters> counters{};
+            size_t counterCount = 0;
+
+            std::vector<SDL_Vertex> vertices;
+            std::vector<int> indices;
+
+            // 3x5 glyphs, one octal digit per row from the top, bit 2 is the left column
+            static std::uint16_t glyph(char c)
+            {
+                static constexpr char chars[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ.:-/";
+                static constexpr std::uint16_t rows[] = {
+                    075557, 026227, 071747, 071317, 055711, 074717, 074757, 071111, 075757, 075717,
+                    025755, 065656, 034443, 065556, 074647, 074644, 034553, 055755, 072227, 011152,
+                    055655, 044447, 057755, 065555, 025552, 065644, 025563, 065655, 034216, 072222,
+                    055557, 055552, 055775, 055255, 055222, 071247, 000002, 002020, 000700, 011244,
+                };
+                if(c >= 'a' && c <= 'z') c -= 'a' - 'A';
+                const char* found = std::strchr(chars, c);
+                return c && found ? rows[found - chars] : 0;
+            }
+
+            void quad(const float& x, const float& y, const float& w, const float& h, const SDL_FColor& color)
+            {
+                const int base = static_cast<int>(vertices.size());
+                vertices.insert(vertices.end(), {
+                    { { x, y }, color, { 0, 0 } }, { { x + w, y }, color, { 0, 0 } },
+                    { { x + w, y + h }, color, { 0, 0 } }, { { x, y + h }, color, { 0, 0 } } });
+                indices.insert(indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+            }
+
+            // one quad per horizontal run of lit pixels
+            void text(float x, const float& y, const char* str, const SDL_FColor& color)
+            {
+                for(; *str; str++, x += 4 * scale) {
+                    const std::uint16_t g = glyph(*str);
+                    for(int row = 0; row < 5; row++) {
+                        const int bits = (g >> (3 * (4 - row))) & 7;
+                        for(int col = 0; col < 3;) {
+                            if(!(bits & (4 >> col))) { col++; continue; }
+                            const int start = col;
+                            while(col < 3 && (bits & (4 >> col))) col++;
+                            quad(x + start * scale, y + row * scale, (col - start) * scale, scale, color);
+                        }
+                    }
+                }
+            }
+
+        public:
+            PerfHud() {
+                vertices.reserve(4096);
+                indices.reserve(6144);
+            }
+
+            // milliseconds spent stepping the world this frame
+            void setPhysicsTime(const float& ms) {
+                physicsMs = ms;
+            }
+
+            // Shows "label value" under the timings. Labels are matched by pointer, so pass
+            // the same string literal every frame; past maxCounters new labels are dropped.
+            void setCounter(const char* label, const size_t& value)
+            {
+                for(size_t i = 0; i < counterCount; i++) {
+                    if(counters[i].label != label) continue;
+                    counters[i].value = value;
+                    return;
+                }
+                if(counterCount < maxCounters) counters[counterCount++] = { label, value };
+            }
+
+            // average over the frames in the graph
+            float frameTime() const
+            {
+                const size_t n = std::min(frames, historySize);
+                if(n == 0) return 0;
+                float sum = 0;
+                for(size_t i = 0; i < n; i++) sum += history[i];
+                return sum / n;
+            }
+
+            void render(SDL_Renderer* renderer, const float& x = 8, const float& y = 8)
+            {
+                const auto now = std::chrono::steady_clock::now();
+                if(lastFrame.time_since_epoch().count() != 0)
+                    history[frames++ % historySize] = std::chrono::duration<float, std::milli>(now - lastFrame).count();
+                lastFrame = now;
+                if(!visible) return;
+
+                vertices.clear();
+                indices.clear();
+
+                const float width = historySize * barWidth;
+                const float height = graphHeight + (3 + counterCount) * lineHeight + 3 * padding;
+                quad(x, y, width + 2 * padding, height, { 0, 0, 0, 0.6f });
+
+                // oldest frame on the left; green within a 60 Hz frame, yellow within 30 Hz, red past it
+                const float gx = x + padding, gy = y + padding;
+                const size_t n = std::min(frames, historySize);
+                for(size_t i = 0; i < n; i++) {
+                    const float ms = history[(frames - n + i) % historySize];
+                    const float h = std::min(ms / graphMaxMs, 1.0f) * graphHeight;
+                    const SDL_FColor color = ms <= 1000.0f / 60 ? SDL_FColor{ 0.2f, 0.9f, 0.3f, 1 }
+                        : ms <= 1000.0f / 30 ? SDL_FColor{ 0.95f, 0.8f, 0.2f, 1 } : SDL_FColor{ 0.95f, 0.25f, 0.2f, 1 };
+                    quad(gx + (historySize - n + i) * barWidth, gy + graphHeight - h, barWidth, h, color);
+                }
+                quad(gx, gy + graphHeight * (1 - 1000.0f / 60 / graphMaxMs), width, 1, { 1, 1, 1, 0.5f });
+
+                const float average = frameTime();
+                const SDL_FColor white{ 1, 1, 1, 1 };
+                char line[32];
+                float ty = gy + graphHeight + padding;
+                std::snprintf(line, sizeof(line), "FPS %.0f", average > 0 ? 1000 / average : 0.0f);
+                text(gx, ty, line, white);
+                std::snprintf(line, sizeof(line), "FRAME %.2f MS", average);
+                text(gx, ty += lineHeight, line, white);
+                std::snprintf(line, sizeof(line), "PHYSICS %.2f MS", physicsMs);
+                text(gx, ty += lineHeight, line, white);
+                for(size_t i = 0; i < counterCount; i++) {
+                    std::snprintf(line, sizeof(line), "%s %zu", counters[i].label, counters[i].value);
+                    text(gx, ty += lineHeight, line, white);
+                }
+
+                SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+                SDL_RenderGeometry(renderer, nullptr, vertices.data(), static_cast<int>(vertices.size()),
+                    indices.data(), static_cast<int>(indices.size()));
+            }
+    };
+
+}
+
+#endif
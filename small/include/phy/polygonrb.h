@@ -2,6 +2,7 @@
 #define __PHY_POLYGON_RB__
 
 #include <vector>
+#include <cmath>
 #include "vec2.h"
 
 namespace phy {
@@ -14,20 +15,72 @@ namespace phy {
 	float im = 1;
     float angVelo = 0;
 	float torque = 0;
-	float theta = 0;
+	phy::vec2 rotor{ 1, 0 };    // (cos, sin) of the orientation; vertices stay in model space
 
     struct { float r, g, b; } color;
 
+    // absolute orientation, for placing a body
     void setRotation(const float& angle) {
-		theta = angle;
-        for(auto& vert: vertices) {
-            vert = vert.rotate(angle);
+        rotor = phy::vec2::fromAngle(angle);
+    }
+
+    // Turns the body by a per-step angle without trig: the Taylor series of (cos, sin)
+    // is exact to float precision for small steps, and renormalizing keeps the rotor
+    // unit length so the shape never drifts. Large turns fall back to cos/sin.
+    void rotate(const float& delta) {
+        phy::vec2 step;
+        if(std::abs(delta) < 0.25f) {
+            const float d2 = delta * delta;
+            step = { 1 - d2 * (0.5f - d2 * (1.0f / 24 - d2 * (1.0f / 720))), delta * (1 - d2 * (1.0f / 6 - d2 * (1.0f / 120))) };
+        } else {
+            step = phy::vec2::fromAngle(delta);
         }
-    } 
+        rotor = rotor.applyRotor(step);
+        rotor *= 1 / std::sqrt(rotor.x * rotor.x + rotor.y * rotor.y);
+    }
 
 	float getRotation() const  {
-		return theta;
+		return std::atan2(rotor.y, rotor.x);
 	}
+
+    // pos + vertices[i].applyRotor(rotor) for every vertex. The cache is rebuilt on the
+    // first call after pos or the rotor changed. Call markDirty() after editing vertices.
+    const std::vector<phy::vec2>& getWorldVertices() const {
+        refreshCache();
+        return worldVertices;
+    }
+
+    // unit normal of the edge from world vertex i to i + 1, the edge's perp(1)
+    const std::vector<phy::vec2>& getEdgeNormals() const {
+        refreshCache();
+        return edgeNormals;
+    }
+
+    void markDirty() {
+        cacheDirty = true;
+    }
+
+    private:
+    mutable std::vector<phy::vec2> worldVertices, edgeNormals;
+    mutable phy::vec2 cachedPos, cachedRotor;
+    mutable bool cacheDirty = true;
+
+    void refreshCache() const {
+        if(!cacheDirty && cachedPos.x == pos.x && cachedPos.y == pos.y && cachedRotor.x == rotor.x && cachedRotor.y == rotor.y && worldVertices.size() == vertices.size())
+            return;
+
+        const size_t n = vertices.size();
+        worldVertices.resize(n);
+        edgeNormals.resize(n);
+        for(size_t i = 0; i < n; i++)
+            worldVertices[i] = pos + vertices[i].applyRotor(rotor);
+        for(size_t i = 0; i < n; i++)
+            edgeNormals[i] = (worldVertices[(i + 1) % n] - worldVertices[i]).perp(1);
+
+        cachedPos = pos;
+        cachedRotor = rotor;
+        cacheDirty = false;
+    }
 };
 
 
@@ -0,0 +1,212 @@
+#ifndef __PHY_PROFILER_H__
+#define __PHY_PROFILER_H__
+
+#include <vector>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <utility>
+#include <tuple>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+    #include <intrin.h>
+#endif
+
+namespace phy {
+
+    // Scoped-zone profiler. PHY_ZONE("name") times the rest of the enclosing scope and
+    // appends it to a ring buffer owned by the calling thread, so zones never take a
+    // lock; the ring keeps the newest `capacity` zones per thread. Zone names must be
+    // string literals (only the pointer is stored).
+    //
+    // Zones are compiled in only when PHY_PROFILE is defined; otherwise PHY_ZONE and
+    // PHY_PROFILE_DUMP expand to nothing. Read the buffers (totals(), writeChromeTrace())
+    // only while no other thread is inside a zone.
+    class Profiler {
+
+        public:
+            static constexpr size_t capacity = size_t(1) << 16;    // zones kept per thread
+            static constexpr size_t maxNames = 32;                 // distinct names summed per thread
+
+            struct Event {
+                const char* name;
+                std::uint64_t start, end;
+            };
+
+        private:
+            struct Total {
+                const char* name;
+                std::uint64_t ticks;
+                std::uint64_t count;
+            };
+
+            struct Buffer {
+                std::vector<Event> events = std::vector<Event>(capacity);
+                std::uint64_t written = 0;
+                std::array<Total, maxNames> totals{};
+                size_t totalCount = 0;
+                std::uint32_t threadId = 0;
+
+                void push(const char* name, const std::uint64_t& start, const std::uint64_t& end)
+                {
+                    events[written++ & (capacity - 1)] = { name, start, end };
+                    for(size_t i = 0; i < totalCount; i++) {
+                        if(totals[i].name != name) continue;
+                        totals[i].ticks += end - start;
+                        totals[i].count++;
+                        return;
+                    }
+                    if(totalCount < maxNames) totals[totalCount++] = { name, end - start, 1 };
+                }
+            };
+
+            // buffers outlive their threads so a pool's zones can still be exported
+            struct Registry {
+                std::mutex mutex;
+                std::vector<std::unique_ptr<Buffer>> buffers;
+                std::uint64_t originTicks = ticks();
+                std::chrono::steady_clock::time_point originTime = std::chrono::steady_clock::now();
+            };
+
+            static Registry& registry() {
+                static Registry r;
+                return r;
+            }
+
+            static Buffer& local()
+            {
+                thread_local Buffer* buffer = nullptr;
+                if(!buffer) {
+                    Registry& r = registry();
+                    std::lock_guard<std::mutex> lock(r.mutex);
+                    r.buffers.push_back(std::make_unique<Buffer>());
+                    buffer = r.buffers.back().get();
+                    buffer->threadId = static_cast<std::uint32_t>(r.buffers.size() - 1);
+                }
+                return *buffer;
+            }
+
+            // nanoseconds per tick, measured over the time since the first zone
+            static double nanosecondsPerTick()
+            {
+                const Registry& r = registry();
+                const std::uint64_t elapsedTicks = ticks() - r.originTicks;
+                const double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - r.originTime).count();
+                return elapsedTicks > 0 ? elapsed / elapsedTicks : 1.0;
+            }
+
+        public:
+            // the time stamp counter where there is one, steady_clock nanoseconds otherwise
+            static std::uint64_t ticks()
+            {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+                return __rdtsc();
+#else
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+            }
+
+            class Zone {
+                Buffer& buffer;
+                const char* name;
+                std::uint64_t start;
+
+                public:
+                    explicit Zone(const char* n): buffer(local()), name(n), start(ticks()) {}
+                    Zone(const Zone&) = delete;
+                    Zone& operator=(const Zone&) = delete;
+
+                    ~Zone() {
+                        buffer.push(name, start, ticks());
+                    }
+            };
+
+            // drops every recorded zone and total
+            static void clear()
+            {
+                Registry& r = registry();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                for(auto& buffer: r.buffers) {
+                    buffer->written = 0;
+                    buffer->totalCount = 0;
+                }
+            }
+
+            // {name, milliseconds, zone count} summed over all threads since the last
+            // clear(), in the order the names were first seen
+            static std::vector<std::tuple<std::string, double, std::uint64_t>> totals()
+            {
+                Registry& r = registry();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                const double msPerTick = nanosecondsPerTick() * 1e-6;
+
+                std::vector<std::tuple<std::string, double, std::uint64_t>> result;
+                for(auto& buffer: r.buffers) {
+                    for(size_t i = 0; i < buffer->totalCount; i++) {
+                        const Total& t = buffer->totals[i];
+                        auto it = result.begin();
+                        while(it != result.end() && std::get<0>(*it) != t.name) ++it;
+                        if(it == result.end()) {
+                            result.emplace_back(t.name, 0.0, 0);
+                            it = result.end() - 1;
+                        }
+                        std::get<1>(*it) += t.ticks * msPerTick;
+                        std::get<2>(*it) += t.count;
+                    }
+                }
+                return result;
+            }
+
+            // Writes the zones still in the buffers as Chrome trace_event JSON, which
+            // Perfetto and chrome://tracing open directly. Returns false if the file
+            // could not be written.
+            static bool writeChromeTrace(const std::string& path)
+            {
+                Registry& r = registry();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                std::FILE* file = std::fopen(path.c_str(), "w");
+                if(!file) return false;
+
+                const double usPerTick = nanosecondsPerTick() * 1e-3;
+                std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+                bool first = true;
+                for(auto& buffer: r.buffers) {
+                    const std::uint64_t count = std::min<std::uint64_t>(buffer->written, capacity);
+                    for(std::uint64_t i = buffer->written - count; i < buffer->written; i++) {
+                        const Event& e = buffer->events[i & (capacity - 1)];
+                        std::fprintf(file, "%s\n{\"name\":\"", first ? "" : ",");
+                        for(const char* c = e.name; *c; c++) {
+                            if(*c == '"' || *c == '\\') std::fputc('\\', file);
+                            std::fputc(*c, file);
+                        }
+                        std::fprintf(file, "\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                            buffer->threadId, (e.start - r.originTicks) * usPerTick, (e.end - e.start) * usPerTick);
+                        first = false;
+                    }
+                }
+                std::fputs("\n]}\n", file);
+                return std::fclose(file) == 0;
+            }
+    };
+
+}
+
+#define PHY_PROFILE_CONCAT_(a, b) a##b
+#define PHY_PROFILE_CONCAT(a, b) PHY_PROFILE_CONCAT_(a, b)
+
+#if defined(PHY_PROFILE)
+    #define PHY_ZONE(name) ::phy::Profiler::Zone PHY_PROFILE_CONCAT(phyZone, __LINE__)(name)
+    #define PHY_PROFILE_DUMP(path) ::phy::Profiler::writeChromeTrace(path)
+#else
+    #define PHY_ZONE(name) ((void)0)
+    #define PHY_PROFILE_DUMP(path) ((void)0)
+#endif
+
+#endif
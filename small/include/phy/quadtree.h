@@ -2,137 +2,909 @@
 #define __PHY_QUADTREE_H__
 
 #include <vector>
+#include <span>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+#include <array>
+#include <type_traits>
+#include <utility>
+#include <bit>
 
 #include "vec2.h"
 #include "geometry.h"
+#include "threadpool.h"
 
-#include <iostream>
 #include <concepts>
 
 namespace phy {
 
+    // All nodes live in one flat pool and link to each other by 32-bit index; the four
+    // children of a node are always allocated as a consecutive block. Objects hang off
+    // their node as a doubly linked list in a second pool. resize() empties both pools
+    // but keeps their capacity, so rebuilding the tree every frame stops allocating
+    // once it has seen the largest scene.
+    //
+    // Scenes that mostly stand still can skip the rebuild: call update() for every
+    // object that moved, remove() for the ones that are gone, then merge() once per
+    // step to fold underfull leaves back into their parent.
+    //
+    // With looseness > 1 the tree runs as a loose quadtree: every node's query bounds
+    // are its cell scaled by looseness around the cell centre, and an object goes by
+    // its centre straight to the deepest level whose loose bounds still fit its size.
+    // Nothing is pinned to a parent for straddling a split line and capacity is not
+    // used for placement. An object needs its centre in the root cell and must fit the
+    // root's loose bounds, since every query is pruned at them.
+    //
+    // build() replaces the whole contents in one top-down pass and can spread the work
+    // over a ThreadPool.
     template<RectangularObjectConcept T>
     class Quadtree {
 
-        int capacity;
-        bool isDivided = false;
-        std::vector<std::shared_ptr<Quadtree<T>>> children;
-        std::vector<T*> objects;
-        Rect2D boundary;
-        float minArea;
+        public:
+            using index_type = std::uint32_t;
+            static constexpr index_type npos = ~index_type(0);
+            static constexpr index_type maxDepth = 16;
+            static constexpr size_t parallelBuildMin = 4096;
+
+            struct Node {
+                Rect2D boundary;
+                index_type parent = npos;
+                index_type depth = 0;
+                index_type firstChild = npos;
+                index_type firstObject = npos;
+                index_type objectCount = 0;
+            };
+
+            // first box a ray runs into; normal is the face it entered through, or zero
+            // when the ray starts inside the box
+            struct RayHit {
+                T* object = nullptr;
+                float t = 0;
+                vec2 normal;
+            };
+
+        private:
+            struct Entry {
+                T* object;
+                index_type node, prev, next;
+            };
+
+            // a slice of the build input and the private pools a worker grows it into
+            struct Subtree {
+                index_type node;
+                T** begin;
+                T** end;
+                std::vector<Node> nodes;
+                std::vector<Entry> entries;
+            };
+            using Range = std::pair<T**, T**>;
+
+            int capacity = 4;
+            float minArea = 1000;
+            float looseness = 1.0f;
+            index_type depthLimit = 0;
+            std::vector<Node> nodes;
+            std::vector<Entry> entries;
+            std::vector<index_type> lookup;         // open addressing, object -> entry
+            std::vector<index_type> mergeQueue;
+            std::vector<index_type> freeBlocks;
+            index_type freeEntry = npos;
+            index_type objectTotal = 0;
+
+            std::vector<T*> scratch;
+            std::vector<Subtree> subtrees, pending;
 
         public:
 
             Quadtree() = default;
-            
-            void resize(const Rect2D& b, const int& c, const float& minArea = 1000)
+
+            void resize(const Rect2D& b, const int& c, const float& minArea = 1000, const float& looseness = 1.0f)
             {
                 capacity = c;
-                boundary = b;
                 this->minArea = minArea;
-                children.clear();
-                objects.clear();
+                this->looseness = std::max(1.0f, looseness);
+
+                depthLimit = 0;
+                for(float hw = b.size.x * 0.5f, hh = b.size.y * 0.5f; depthLimit < maxDepth && hw * hh >= minArea; hw *= 0.5f, hh *= 0.5f)
+                    depthLimit++;
+
+                // b may be this tree's own root boundary (build() passes it), so copy it first
+                const Rect2D boundary = b;
+                nodes.clear();
+                entries.clear();
+                mergeQueue.clear();
+                freeBlocks.clear();
+                std::fill(lookup.begin(), lookup.end(), npos);
+                freeEntry = npos;
+                objectTotal = 0;
+                nodes.push_back(Node{ boundary });
+            }
+
+            // Empties the tree and places every object in one top-down pass. Each node
+            // partitions its slice of the input in place by quadrant, which is an MSD radix
+            // sort of the objects into Morton order, and only splits once it knows it has to.
+            // With a pool, the top levels are expanded serially until there are a few
+            // subtrees per thread; those are built in parallel into private pools and then
+            // spliced in. Objects must be distinct; ones outside the boundary are skipped.
+            void build(std::span<T* const> objects, ThreadPool* pool = nullptr)
+            {
+                if(nodes.empty()) return;
+                resize(getBoundary(), capacity, minArea, looseness);
+
+                scratch.clear();
+                for(T* object: objects) {
+                    if(accepts(object)) scratch.push_back(object);
+                }
+                T** first = scratch.data();
+                T** last = first + scratch.size();
+
+                if(!pool || pool->size() == 1 || scratch.size() < parallelBuildMin) {
+                    buildNode(nodes, entries, 0, first, last);
+                } else {
+                    buildParallel(*pool, first, last);
+                }
+
+                objectTotal = static_cast<index_type>(entries.size());
+                rehash(std::bit_ceil(std::max<size_t>(64, (size_t(objectTotal) + 1) * 2)));
+            }
+
+            void getRange(const Rect2D& range, std::vector<T*>& queried) const
+            {
+                query(range, [&](T* object) { queried.push_back(object); });
+            }
+
+            // Writes up to out.size() hits into out and returns how many objects overlap
+            // range; a result larger than out.size() means the buffer was too small.
+            size_t getRange(const Rect2D& range, std::span<T*> out) const
+            {
+                size_t count = 0;
+                query(range, [&](T* object) {
+                    if(count < out.size()) out[count] = object;
+                    count++;
+                });
+                return count;
+            }
+
+            // Calls visitor(T*) for every object overlapping range. A visitor returning
+            // bool can stop the walk early by returning false. The traversal runs on a
+            // fixed stack sized for maxDepth, so it never touches the heap.
+            template<typename F>
+            void query(const Rect2D& range, F&& visitor) const
+            {
+                if(nodes.empty()) return;
+
+                std::array<index_type, 4 * maxDepth> stack;
+                size_t top = 0;
+                stack[top++] = 0;
+
+                while(top) {
+                    const Node& node = nodes[stack[--top]];
+                    if(!rectToRectIntersect(range, getLooseBoundary(node))) continue;
+
+                    for(index_type e = node.firstObject; e != npos; e = entries[e].next) {
+                        if(!rectToRectIntersect(*entries[e].object, range)) continue;
+
+                        if constexpr (std::is_same_v<std::invoke_result_t<F&, T*>, bool>) {
+                            if(!visitor(entries[e].object)) return;
+                        } else {
+                            visitor(entries[e].object);
+                        }
+                    }
+
+                    if(node.firstChild == npos) continue;
+                    for(index_type c = 0; c < 4; c++) stack[top++] = node.firstChild + 3 - c;
+                }
+            }
+
+            // Calls visitor(T*) for every object whose box comes within radius of center,
+            // with the same early-out rule as query(). Nodes further away are skipped whole.
+            template<typename F>
+            void queryRadius(const vec2& center, const float& radius, F&& visitor) const
+            {
+                if(nodes.empty()) return;
+
+                const float radiusSq = radius * radius;
+                std::array<index_type, 4 * maxDepth> stack;
+                size_t top = 0;
+                stack[top++] = 0;
+
+                while(top) {
+                    const Node& node = nodes[stack[--top]];
+                    if(distanceSq(center, getLooseBoundary(node)) > radiusSq) continue;
+
+                    for(index_type e = node.firstObject; e != npos; e = entries[e].next) {
+                        if(distanceSq(center, *entries[e].object) > radiusSq) continue;
+
+                        if constexpr (std::is_same_v<std::invoke_result_t<F&, T*>, bool>) {
+                            if(!visitor(entries[e].object)) return;
+                        } else {
+                            visitor(entries[e].object);
+                        }
+                    }
+
+                    if(node.firstChild == npos) continue;
+                    for(index_type c = 0; c < 4; c++) stack[top++] = node.firstChild + 3 - c;
+                }
+            }
+
+            // Fills out with the out.size() objects whose boxes are closest to point, nearest
+            // first, and returns how many it found. out doubles as a bounded max-heap while
+            // searching: children are visited nearest first and any node no closer than
+            // the current k-th best is pruned, so nothing is allocated.
+            size_t queryKNearest(const vec2& point, std::span<T*> out) const
+            {
+                if(nodes.empty() || out.empty()) return 0;
+
+                const size_t k = out.size();
+                size_t count = 0;
+                auto closer = [&](const T* a, const T* b) { return distanceSq(point, *a) < distanceSq(point, *b); };
+
+                std::array<index_type, 4 * maxDepth> stack;
+                size_t top = 0;
+                stack[top++] = 0;
+
+                while(top) {
+                    const Node& node = nodes[stack[--top]];
+                    if(count == k && distanceSq(point, getLooseBoundary(node)) >= distanceSq(point, *out[0])) continue;
+
+                    for(index_type e = node.firstObject; e != npos; e = entries[e].next) {
+                        T* object = entries[e].object;
+                        if(count < k) {
+                            out[count++] = object;
+                            std::push_heap(out.begin(), out.begin() + count, closer);
+                        } else if(closer(object, out[0])) {
+                            std::pop_heap(out.begin(), out.end(), closer);
+                            out[k - 1] = object;
+                            std::push_heap(out.begin(), out.end(), closer);
+                        }
+                    }
+
+                    if(node.firstChild == npos) continue;
+
+                    // push the farthest child first so the nearest is searched next
+                    std::array<std::pair<float, index_type>, 4> children;
+                    for(index_type c = 0; c < 4; c++) {
+                        const index_type child = node.firstChild + c;
+                        children[c] = { distanceSq(point, getLooseBoundary(nodes[child])), child };
+                    }
+                    std::sort(children.begin(), children.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+                    for(const auto& [d, child]: children) stack[top++] = child;
+                }
+
+                std::sort_heap(out.begin(), out.begin() + count, closer);
+                return count;
+            }
+
+            // resizes nearest to the k closest objects, nearest first
+            void queryKNearest(const vec2& point, const size_t& k, std::vector<T*>& nearest) const
+            {
+                nearest.resize(k);
+                nearest.resize(queryKNearest(point, std::span<T*>(nearest)));
             }
 
-            void getRange(const Rect2D& range, std::vector<T*>& queried)
+            // Finds the nearest object box along ray. Nodes are walked front to back: the
+            // children a ray enters are pushed farthest first, and anything entered no
+            // sooner than the best hit so far is skipped.
+            bool raycast(const Ray2D& ray, RayHit& hit) const
             {
-                if(!rectToRectIntersect(range, boundary)) return;
+                hit = RayHit{};
+                if(nodes.empty()) return false;
+
+                float best = ray.maxT, t;
+                vec2 normal;
+                if(!rayToRect(ray, getLooseBoundary(nodes[0]), best, t, normal)) return false;
+
+                std::array<std::pair<index_type, float>, 4 * maxDepth> stack;
+                size_t top = 0;
+                stack[top++] = { 0, t };
 
-                for(auto& object: objects) {
-                    if(rectToRectIntersect(*object, range))
-                        queried.push_back(object);
+                while(top) {
+                    const auto [index, entry] = stack[--top];
+                    if(entry >= best) continue;
+                    const Node& node = nodes[index];
+
+                    for(index_type e = node.firstObject; e != npos; e = entries[e].next) {
+                        if(!rayToRect(ray, *entries[e].object, best, t, normal)) continue;
+                        best = t;
+                        hit = RayHit{ entries[e].object, t, normal };
+                    }
+
+                    if(node.firstChild == npos) continue;
+
+                    std::array<std::pair<index_type, float>, 4> children;
+                    index_type count = 0;
+                    for(index_type c = 0; c < 4; c++) {
+                        if(rayToRect(ray, getLooseBoundary(nodes[node.firstChild + c]), best, t, normal))
+                            children[count++] = { node.firstChild + c, t };
+                    }
+                    // at most four, farthest first
+                    for(index_type i = 1; i < count; i++) {
+                        for(index_type j = i; j > 0 && children[j - 1].second < children[j].second; j--)
+                            std::swap(children[j - 1], children[j]);
+                    }
+                    for(index_type c = 0; c < count; c++) stack[top++] = children[c];
                 }
+                return hit.object != nullptr;
+            }
 
-                for(auto& child: children) child->getRange(range, queried);
+            // hits[i] gets the first hit of rays[i] (object is null on a miss); returns
+            // the number of rays that hit something
+            size_t raycast(std::span<const Ray2D> rays, std::span<RayHit> hits) const
+            {
+                size_t count = 0;
+                for(size_t i = 0; i < rays.size() && i < hits.size(); i++) {
+                    if(raycast(rays[i], hits[i])) count++;
+                }
+                return count;
             }
 
             bool insert(T* object) {
-                if(!rectFitCompletely(object, boundary))
+                if(nodes.empty() || !accepts(object))
                     return false;
 
-                if(objects.size() < capacity && !children.size()) {
-                    objects.push_back(object);
+                if(find(object) != npos) return update(object);
+
+                const index_type e = allocateEntry(object);
+                if(isLoose()) placeLoose(e);
+                else placeEntry(0, e);
+                return true;
+            }
+
+            // Re-homes object after it moved. Objects still inside their node stay put
+            // (or sink into a child they now fit); the rest climb to the first ancestor
+            // that holds them and are reinserted from there. Returns false and drops the
+            // object if it left the root boundary.
+            bool update(T* object) {
+                if(nodes.empty()) return false;
+
+                const index_type e = find(object);
+                if(e == npos) return insert(object);
+
+                const index_type from = entries[e].node;
+                if(isLoose()) {
+                    if(!accepts(object)) {
+                        remove(object);
+                        return false;
+                    }
+                    if(nodes[from].depth == targetDepth(object) && pointInRect(centerOf(object), nodes[from].boundary))
+                        return true;
+
+                    unlink(e);
+                    placeLoose(e);
+                    if(entries[e].node != from) mergeQueue.push_back(from);
                     return true;
-                } else {
-                    subdivide();
                 }
-                
-                for(auto& child: children) 
-                {
-                    if(child->insert(object)) {
+
+                index_type index = from;
+                while(index != 0 && !rectFitCompletely(object, nodes[index].boundary))
+                    index = nodes[index].parent;
+
+                if(!rectFitCompletely(object, nodes[index].boundary)) {
+                    remove(object);
+                    return false;
+                }
+
+                if(index == from) {
+                    if(nodes[from].firstChild == npos || findChild(from, object) == npos)
                         return true;
-                        break;
-                    }
                 }
 
-                objects.push_back(object);
+                unlink(e);
+                placeEntry(index, e);
+                if(entries[e].node != from) mergeQueue.push_back(from);
+                return true;
+            }
+
+            bool remove(T* object) {
+                const index_type e = find(object);
+                if(e == npos) return false;
 
+                mergeQueue.push_back(entries[e].node);
+                unlink(e);
+                erase(object);
+                entries[e].object = nullptr;
+                entries[e].next = freeEntry;
+                freeEntry = e;
+                objectTotal--;
                 return true;
             }
 
-            const decltype(children)& getChildren() const {
-                return children;
+            // Folds children back into their parent wherever a parent and its four leaf
+            // children together hold no more than capacity objects (in loose mode: where
+            // all four leaves are empty). Only nodes touched by update()/remove() since the
+            // last call are visited.
+            void merge() {
+                for(size_t i = 0; i < mergeQueue.size(); i++) {
+                    index_type index = mergeQueue[i];
+                    if(index != 0 && nodes[index].parent == npos) continue;   // freed by an earlier collapse
+                    if(nodes[index].firstChild == npos) index = nodes[index].parent;
+
+                    while(index != npos && canCollapse(index)) {
+                        collapse(index);
+                        index = nodes[index].parent;
+                    }
+                }
+                mergeQueue.clear();
+            }
+
+            const Node& getRoot() const {
+                return nodes[0];
+            }
+
+            std::span<const Node> getChildren(const Node& node) const {
+                if(node.firstChild == npos) return {};
+                return { nodes.data() + node.firstChild, 4 };
+            }
+
+            std::span<const Node> getChildren() const {
+                return getChildren(getRoot());
             }
 
             const Rect2D& getBoundary() const {
-                return boundary;
+                return getRoot().boundary;
+            }
+
+            size_t nodeCount() const {
+                return nodes.size();
+            }
+
+            size_t size() const {
+                return objectTotal;
+            }
+
+            bool isLoose() const {
+                return looseness > 1.0f;
+            }
+
+            // the region a node's objects can reach; equal to the cell unless the tree is loose
+            Rect2D getLooseBoundary(const Node& node) const {
+                const vec2 margin = node.boundary.size * ((looseness - 1.0f) * 0.5f);
+                return Rect2D{ node.boundary.pos - margin, node.boundary.size + margin * 2.0f };
             }
 
         private:
-            void subdivide() {
-                const auto bh = boundary.size * 0.5f;
-                if(children.size() || bh.x * bh.y < minArea) return;
-
-                children.emplace_back(new Quadtree<T>());
-                children.emplace_back(new Quadtree<T>());
-                children.emplace_back(new Quadtree<T>());
-                children.emplace_back(new Quadtree<T>());
-
-                const float hw = boundary.size.x * 0.5;
-                const float hh = boundary.size.y * 0.5;
-                children[0]->resize(phy::Rect2D{ {boundary.pos.x, boundary.pos.y}, { hw, hh } }, capacity, minArea);
-                children[1]->resize(phy::Rect2D{ {boundary.pos.x + hw, boundary.pos.y}, { hw, hh } }, capacity, minArea);
-                children[2]->resize(phy::Rect2D{ {boundary.pos.x, boundary.pos.y + hh}, { hw, hh } }, capacity, minArea);
-                children[3]->resize(phy::Rect2D{ {boundary.pos.x + hw, boundary.pos.y + hh}, { hw, hh } }, capacity, minArea);
-
-                redistributeObject();
-            }
-
-            void redistributeObject() { 
-                std::vector<int> toBeDeleted;
-                int i = 0;
-                for(auto it = objects.begin(); it != objects.end(); it++)
-                {
-                    for(auto child: children)
-                    {
-                        if(child->insert(*it)) {
-                            toBeDeleted.push_back(i);
-                            continue;
+            // walks down from index, splitting full leaves on the way, and links e where it stops
+            void placeEntry(index_type index, const index_type& e) {
+                T* object = entries[e].object;
+                while(true) {
+                    if(nodes[index].firstChild == npos) {
+                        if(nodes[index].objectCount < static_cast<index_type>(capacity) || !subdivide(index)) {
+                            link(index, e);
+                            return;
                         }
                     }
-                    i++;
+
+                    const index_type child = findChild(index, object);
+                    if(child == npos) {
+                        link(index, e);
+                        return;
+                    }
+                    index = child;
                 }
+            }
 
-                for(auto& index: toBeDeleted) {
-                    objects.erase(objects.begin() + index, objects.begin() + index + 1);
+            // loose placement: follow the centre down to the object's level, splitting as needed
+            void placeLoose(const index_type& e) {
+                const T* object = entries[e].object;
+                const index_type depth = targetDepth(object);
+                const vec2 center = centerOf(object);
+
+                index_type index = 0;
+                while(nodes[index].depth < depth) {
+                    if(nodes[index].firstChild == npos) split(index);
+
+                    const Node& node = nodes[index];
+                    const vec2 mid = node.boundary.pos + node.boundary.size * 0.5f;
+                    index = node.firstChild + (center.x >= mid.x ? 1 : 0) + (center.y >= mid.y ? 2 : 0);
                 }
+                link(index, e);
             }
 
-            inline constexpr bool rectFitCompletely(const T* rect, const phy::Rect2D& boundary) {
+            // deepest level whose loose bounds (looseness times the cell) still fit the object
+            index_type targetDepth(const T* object) const {
+                const Rect2D& root = nodes[0].boundary;
+                const float reach = looseness - 1.0f;
+                index_type depth = depthLimit;
+                if(object->size.x > 0) depth = std::min(depth, levelFor(reach * root.size.x / object->size.x));
+                if(object->size.y > 0) depth = std::min(depth, levelFor(reach * root.size.y / object->size.y));
+                return depth;
+            }
+
+            static index_type levelFor(const float& ratio) {
+                return ratio < 1.0f ? 0 : static_cast<index_type>(std::ilogb(ratio));
+            }
+
+            bool subdivide(const index_type& index) {
+                const Rect2D boundary = nodes[index].boundary;
+                if(nodes[index].depth >= depthLimit || boundary.size.x * boundary.size.y * 0.25f < minArea) return false;
+
+                split(index);
+                redistributeObject(index);
+                return true;
+            }
+
+            void split(const index_type& index) {
+                index_type first;
+                if(!freeBlocks.empty()) {
+                    first = freeBlocks.back();
+                    freeBlocks.pop_back();
+                } else {
+                    first = static_cast<index_type>(nodes.size());
+                    nodes.resize(nodes.size() + 4);
+                }
+                makeChildren(nodes, index, first);
+            }
+
+            static void makeChildren(std::vector<Node>& pool, const index_type& index, const index_type& first) {
+                const Rect2D boundary = pool[index].boundary;
+                const index_type depth = pool[index].depth + 1;
+                const float hw = boundary.size.x * 0.5f;
+                const float hh = boundary.size.y * 0.5f;
+
+                pool[first + 0] = Node{ Rect2D{ {boundary.pos.x, boundary.pos.y}, { hw, hh } }, index, depth };
+                pool[first + 1] = Node{ Rect2D{ {boundary.pos.x + hw, boundary.pos.y}, { hw, hh } }, index, depth };
+                pool[first + 2] = Node{ Rect2D{ {boundary.pos.x, boundary.pos.y + hh}, { hw, hh } }, index, depth };
+                pool[first + 3] = Node{ Rect2D{ {boundary.pos.x + hw, boundary.pos.y + hh}, { hw, hh } }, index, depth };
+                pool[index].firstChild = first;
+            }
+
+            void buildNode(std::vector<Node>& pool, std::vector<Entry>& entryPool, const index_type& index, T** begin, T** end) const {
+                std::array<Range, 4> children;
+                if(!expandNode(pool, entryPool, index, begin, end, children)) return;
+
+                const index_type first = pool[index].firstChild;
+                for(index_type c = 0; c < 4; c++)
+                    buildNode(pool, entryPool, first + c, children[c].first, children[c].second);
+            }
+
+            // Links the objects that belong to index itself and, if any have to go deeper,
+            // splits it and reports each child's slice. Returns false for a leaf.
+            bool expandNode(std::vector<Node>& pool, std::vector<Entry>& entryPool, const index_type& index, T** begin, T** end, std::array<Range, 4>& children) const {
+                const Rect2D boundary = pool[index].boundary;
+                const index_type depth = pool[index].depth;
+
+                bool deeper;
+                if(isLoose()) {
+                    deeper = std::any_of(begin, end, [&](const T* object) { return targetDepth(object) > depth; });
+                } else {
+                    deeper = end - begin > capacity && depth < depthLimit && boundary.size.x * boundary.size.y * 0.25f >= minArea;
+                }
+
+                if(!deeper) {
+                    for(T** it = begin; it != end; it++) append(pool, entryPool, index, *it);
+                    return false;
+                }
+
+                auto quadrant = [&](const T* object) -> index_type {
+                    if(!isLoose()) return quadrantOf(boundary, object);
+                    if(targetDepth(object) <= depth) return npos;
+
+                    const vec2 center = centerOf(object);
+                    const vec2 mid = boundary.pos + boundary.size * 0.5f;
+                    return (center.x >= mid.x ? 1 : 0) + (center.y >= mid.y ? 2 : 0);
+                };
+
+                // objects staying here first, then one run per quadrant
+                T** q0 = std::partition(begin, end, [&](const T* object) { return quadrant(object) == npos; });
+                T** q2 = std::partition(q0, end, [&](const T* object) { return quadrant(object) < 2; });
+                T** q1 = std::partition(q0, q2, [&](const T* object) { return quadrant(object) == 0; });
+                T** q3 = std::partition(q2, end, [&](const T* object) { return quadrant(object) == 2; });
+
+                for(T** it = begin; it != q0; it++) append(pool, entryPool, index, *it);
+
+                const index_type first = static_cast<index_type>(pool.size());
+                pool.resize(pool.size() + 4);
+                makeChildren(pool, index, first);
+
+                children = { Range{ q0, q1 }, Range{ q1, q2 }, Range{ q2, q3 }, Range{ q3, end } };
+                return true;
+            }
+
+            void buildParallel(ThreadPool& pool, T** begin, T** end) {
+                // breadth-first until every thread has a few subtrees to pick from
+                size_t count = 0, nextCount = 0;
+                auto push = [](std::vector<Subtree>& list, size_t& n, const index_type& node, T** b, T** e) {
+                    if(n == list.size()) list.emplace_back();
+                    list[n].node = node;
+                    list[n].begin = b;
+                    list[n].end = e;
+                    n++;
+                };
+
+                push(subtrees, count, 0, begin, end);
+                while(count && count < pool.size() * 4) {
+                    nextCount = 0;
+                    for(size_t i = 0; i < count; i++) {
+                        std::array<Range, 4> children;
+                        if(!expandNode(nodes, entries, subtrees[i].node, subtrees[i].begin, subtrees[i].end, children)) continue;
+
+                        const index_type first = nodes[subtrees[i].node].firstChild;
+                        for(index_type c = 0; c < 4; c++) {
+                            if(children[c].first != children[c].second)
+                                push(pending, nextCount, first + c, children[c].first, children[c].second);
+                        }
+                    }
+                    std::swap(subtrees, pending);
+                    count = nextCount;
+                }
+
+                pool.parallelFor(count, [&](const size_t& i) {
+                    Subtree& subtree = subtrees[i];
+                    subtree.nodes.clear();
+                    subtree.entries.clear();
+                    subtree.nodes.push_back(nodes[subtree.node]);
+                    buildNode(subtree.nodes, subtree.entries, 0, subtree.begin, subtree.end);
+                });
+
+                for(size_t i = 0; i < count; i++) splice(subtrees[i]);
+            }
+
+            // appends a subtree's private pools to the main ones; its node 0 is subtree.node
+            void splice(const Subtree& subtree) {
+                const index_type root = subtree.node;
+                const index_type nodeBase = static_cast<index_type>(nodes.size()) - 1;
+                const index_type entryBase = static_cast<index_type>(entries.size());
+
+                auto node = [&](const index_type& local) {
+                    return local == npos ? npos : local == 0 ? root : nodeBase + local;
+                };
+                auto entry = [&](const index_type& local) {
+                    return local == npos ? npos : entryBase + local;
+                };
+
+                nodes[root].firstChild = node(subtree.nodes[0].firstChild);
+                nodes[root].firstObject = entry(subtree.nodes[0].firstObject);
+                nodes[root].objectCount = subtree.nodes[0].objectCount;
+
+                for(size_t i = 1; i < subtree.nodes.size(); i++) {
+                    Node n = subtree.nodes[i];
+                    n.parent = node(n.parent);
+                    n.firstChild = node(n.firstChild);
+                    n.firstObject = entry(n.firstObject);
+                    nodes.push_back(n);
+                }
+
+                for(Entry e: subtree.entries) {
+                    e.node = node(e.node);
+                    e.prev = entry(e.prev);
+                    e.next = entry(e.next);
+                    entries.push_back(e);
+                }
+            }
+
+            static void append(std::vector<Node>& pool, std::vector<Entry>& entryPool, const index_type& index, T* object) {
+                const index_type e = static_cast<index_type>(entryPool.size());
+                const index_type head = pool[index].firstObject;
+                entryPool.push_back(Entry{ object, index, npos, head });
+                if(head != npos) entryPool[head].prev = e;
+                pool[index].firstObject = e;
+                pool[index].objectCount++;
+            }
+
+            void redistributeObject(const index_type& index) {
+                index_type e = nodes[index].firstObject;
+                while(e != npos) {
+                    const index_type next = entries[e].next;
+                    const index_type child = findChild(index, entries[e].object);
+                    if(child != npos) {
+                        unlink(e);
+                        link(child, e);
+                    }
+                    e = next;
+                }
+            }
+
+            bool canCollapse(const index_type& index) const {
+                const Node& node = nodes[index];
+                if(node.firstChild == npos) return false;
+
+                index_type total = node.objectCount, held = 0;
+                for(index_type c = 0; c < 4; c++) {
+                    const Node& child = nodes[node.firstChild + c];
+                    if(child.firstChild != npos) return false;
+                    held += child.objectCount;
+                }
+
+                // loose objects sit at the level their size asks for, so only empty leaves fold
+                if(isLoose()) return held == 0;
+                return total + held <= static_cast<index_type>(capacity);
+            }
+
+            void collapse(const index_type& index) {
+                const index_type first = nodes[index].firstChild;
+                for(index_type c = 0; c < 4; c++) {
+                    index_type e = nodes[first + c].firstObject;
+                    while(e != npos) {
+                        const index_type next = entries[e].next;
+                        unlink(e);
+                        link(index, e);
+                        e = next;
+                    }
+                    nodes[first + c].parent = npos;
+                }
+
+                nodes[index].firstChild = npos;
+                freeBlocks.push_back(first);
+            }
+
+            index_type allocateEntry(T* object) {
+                if((objectTotal + 1) * 2 > lookup.size()) rehash(std::max<size_t>(64, lookup.size() * 2));
+
+                index_type e = freeEntry;
+                if(e != npos) {
+                    freeEntry = entries[e].next;
+                    entries[e] = Entry{ object, npos, npos, npos };
+                } else {
+                    e = static_cast<index_type>(entries.size());
+                    entries.push_back(Entry{ object, npos, npos, npos });
+                }
+                objectTotal++;
+                emplace(object, e);
+                return e;
+            }
+
+            void link(const index_type& index, const index_type& e) {
+                Node& node = nodes[index];
+                entries[e].node = index;
+                entries[e].prev = npos;
+                entries[e].next = node.firstObject;
+                if(node.firstObject != npos) entries[node.firstObject].prev = e;
+                node.firstObject = e;
+                node.objectCount++;
+            }
+
+            void unlink(const index_type& e) {
+                Entry& entry = entries[e];
+                Node& node = nodes[entry.node];
+                if(entry.prev != npos) entries[entry.prev].next = entry.next;
+                else node.firstObject = entry.next;
+                if(entry.next != npos) entries[entry.next].prev = entry.prev;
+                node.objectCount--;
+            }
+
+            // child quadrant that fully contains object, or npos if it straddles a split line
+            index_type findChild(const index_type& index, const T* object) const {
+                const index_type quadrant = quadrantOf(nodes[index].boundary, object);
+                return quadrant == npos ? npos : nodes[index].firstChild + quadrant;
+            }
+
+            static index_type quadrantOf(const Rect2D& boundary, const T* object) {
+                const float mx = boundary.pos.x + boundary.size.x * 0.5f;
+                const float my = boundary.pos.y + boundary.size.y * 0.5f;
+
+                index_type quadrant = 0;
+                if(object->pos.x >= mx) quadrant |= 1;
+                else if(object->pos.x + object->size.x > mx) return npos;
+
+                if(object->pos.y >= my) quadrant |= 2;
+                else if(object->pos.y + object->size.y > my) return npos;
+
+                return quadrant;
+            }
+
+            static size_t hash(const T* object) {
+                return (reinterpret_cast<std::uintptr_t>(object) >> 3) * 0x9E3779B97F4A7C15ull;
+            }
+
+            index_type find(const T* object) const {
+                if(lookup.empty()) return npos;
+                const size_t mask = lookup.size() - 1;
+                for(size_t slot = hash(object) & mask; lookup[slot] != npos; slot = (slot + 1) & mask) {
+                    if(entries[lookup[slot]].object == object) return lookup[slot];
+                }
+                return npos;
+            }
+
+            void emplace(const T* object, const index_type& e) {
+                const size_t mask = lookup.size() - 1;
+                size_t slot = hash(object) & mask;
+                while(lookup[slot] != npos) slot = (slot + 1) & mask;
+                lookup[slot] = e;
+            }
+
+            void erase(const T* object) {
+                const size_t mask = lookup.size() - 1;
+                size_t slot = hash(object) & mask;
+                while(entries[lookup[slot]].object != object) slot = (slot + 1) & mask;
+
+                // backward-shift deletion keeps probe chains intact without tombstones
+                size_t next = (slot + 1) & mask;
+                while(lookup[next] != npos) {
+                    const size_t home = hash(entries[lookup[next]].object) & mask;
+                    if(((next - home) & mask) >= ((next - slot) & mask)) {
+                        lookup[slot] = lookup[next];
+                        slot = next;
+                    }
+                    next = (next + 1) & mask;
+                }
+                lookup[slot] = npos;
+            }
+
+            void rehash(const size_t& slots) {
+                lookup.assign(slots, npos);
+                const size_t mask = slots - 1;
+                for(index_type e = 0; e < entries.size(); e++) {
+                    if(!entries[e].object) continue;
+                    size_t slot = hash(entries[e].object) & mask;
+                    while(lookup[slot] != npos) slot = (slot + 1) & mask;
+                    lookup[slot] = e;
+                }
+            }
+
+            bool accepts(const T* object) const {
+                if(isLoose())
+                    return pointInRect(centerOf(object), nodes[0].boundary) && rectFitCompletely(object, getLooseBoundary(nodes[0]));
+                return rectFitCompletely(object, nodes[0].boundary);
+            }
+
+            static vec2 centerOf(const T* object) {
+                return vec2{ object->pos.x + object->size.x * 0.5f, object->pos.y + object->size.y * 0.5f };
+            }
+
+            // slab test: entry t of the ray into box if it is below limit
+            template<RectangularObjectConcept A>
+            static bool rayToRect(const Ray2D& ray, const A& box, const float& limit, float& t, vec2& normal) {
+                float tMin = 0, tMax = limit;
+                normal = { 0, 0 };
+
+                const float origin[2] = { ray.origin.x, ray.origin.y };
+                const float dir[2] = { ray.dir.x, ray.dir.y };
+                const float lo[2] = { box.pos.x, box.pos.y };
+                const float hi[2] = { box.pos.x + box.size.x, box.pos.y + box.size.y };
+
+                for(int axis = 0; axis < 2; axis++) {
+                    if(dir[axis] == 0) {
+                        if(origin[axis] < lo[axis] || origin[axis] > hi[axis]) return false;
+                        continue;
+                    }
+
+                    float t0 = (lo[axis] - origin[axis]) / dir[axis];
+                    float t1 = (hi[axis] - origin[axis]) / dir[axis];
+                    float side = -1;
+                    if(t0 > t1) {
+                        std::swap(t0, t1);
+                        side = 1;
+                    }
+                    if(t0 > tMin) {
+                        tMin = t0;
+                        normal = axis == 0 ? vec2{ side, 0 } : vec2{ 0, side };
+                    }
+                    tMax = std::min(tMax, t1);
+                    if(tMin > tMax) return false;
+                }
+
+                t = tMin;
+                return tMin < limit;
+            }
+
+            // squared distance from p to the nearest point of a box, 0 inside it
+            template<RectangularObjectConcept A>
+            static float distanceSq(const vec2& p, const A& box) {
+                const float dx = std::max({ box.pos.x - p.x, 0.0f, p.x - (box.pos.x + box.size.x) });
+                const float dy = std::max({ box.pos.y - p.y, 0.0f, p.y - (box.pos.y + box.size.y) });
+                return dx * dx + dy * dy;
+            }
+
+            static constexpr bool pointInRect(const vec2& p, const phy::Rect2D& boundary) {
+                return p.x >= boundary.pos.x && p.x <= boundary.pos.x + boundary.size.x
+                    && p.y >= boundary.pos.y && p.y <= boundary.pos.y + boundary.size.y;
+            }
+
+            inline constexpr bool rectFitCompletely(const T* rect, const phy::Rect2D& boundary) const {
                 return rect->pos.x >= boundary.pos.x && (rect->pos.x + rect->size.x) <= boundary.pos.x + boundary.size.x
                     && rect->pos.y >= boundary.pos.y && (rect->pos.y + rect->size.y) <= boundary.pos.y + boundary.size.y;
             }
 
-            template<RectangularObjectConcept A>
-            inline constexpr bool rectToRectIntersect(const A& a, const A& b)
+            template<RectangularObjectConcept A, RectangularObjectConcept B>
+            inline constexpr bool rectToRectIntersect(const A& a, const B& b) const
             {
-                return (a.pos.x < b.pos.x + b.size.x && a.pos.x + a.size.x > b.pos.x && 
+                return (a.pos.x < b.pos.x + b.size.x && a.pos.x + a.size.x > b.pos.x &&
                     a.pos.y < b.pos.y + b.size.y && a.pos.y + a.size.y > b.pos.y);
-                return false;
             }
     };
 
 
 }
 
-#endif 
\ No newline at end of file
+#endif
\ No newline at end of file
@@ -0,0 +1,202 @@
+#ifndef __PHY_SIMD_H__
+#define __PHY_SIMD_H__
+
+#include <span>
+#include <cmath>
+#include <cstddef>
+
+#include "vec2.h"
+
+// AVX2 when the compiler targets it (-mavx2 or -march=native), SSE2 on any other x86-64,
+// plain loops otherwise. Define PHY_SIMD_SCALAR to force the plain loops.
+#if !defined(PHY_SIMD_SCALAR) && defined(__AVX2__)
+    #define PHY_SIMD_AVX2
+    #include <immintrin.h>
+#elif !defined(PHY_SIMD_SCALAR) && (defined(__SSE2__) || defined(_M_X64))
+    #define PHY_SIMD_SSE2
+    #include <emmintrin.h>
+#endif
+
+namespace phy::simd {
+
+    // Batch vec2 math over structure-of-arrays spans: vector i is (x[i], y[i]). Every
+    // span of one call must hold the same number of elements; results may be written
+    // over the inputs. The leftover elements past the last full register go through
+    // the same math one at a time.
+
+    namespace detail {
+
+#if defined(PHY_SIMD_AVX2)
+        struct batch {
+            __m256 v;
+            static constexpr size_t width = 8;
+
+            static batch load(const float* p) { return { _mm256_loadu_ps(p) }; }
+            static batch broadcast(const float& f) { return { _mm256_set1_ps(f) }; }
+            void store(float* p) const { _mm256_storeu_ps(p, v); }
+
+            batch operator+(const batch& b) const { return { _mm256_add_ps(v, b.v) }; }
+            batch operator-(const batch& b) const { return { _mm256_sub_ps(v, b.v) }; }
+            batch operator*(const batch& b) const { return { _mm256_mul_ps(v, b.v) }; }
+
+            batch sqrt() const { return { _mm256_sqrt_ps(v) }; }
+
+            // ~12-bit estimate plus one Newton step, 0 where v is 0
+            batch rsqrt() const {
+                const __m256 e = _mm256_rsqrt_ps(v);
+                const __m256 refined = _mm256_mul_ps(e, _mm256_sub_ps(_mm256_set1_ps(1.5f),
+                    _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), v), _mm256_mul_ps(e, e))));
+                return { _mm256_and_ps(refined, _mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_GT_OQ)) };
+            }
+        };
+#elif defined(PHY_SIMD_SSE2)
+        struct batch {
+            __m128 v;
+            static constexpr size_t width = 4;
+
+            static batch load(const float* p) { return { _mm_loadu_ps(p) }; }
+            static batch broadcast(const float& f) { return { _mm_set1_ps(f) }; }
+            void store(float* p) const { _mm_storeu_ps(p, v); }
+
+            batch operator+(const batch& b) const { return { _mm_add_ps(v, b.v) }; }
+            batch operator-(const batch& b) const { return { _mm_sub_ps(v, b.v) }; }
+            batch operator*(const batch& b) const { return { _mm_mul_ps(v, b.v) }; }
+
+            batch sqrt() const { return { _mm_sqrt_ps(v) }; }
+
+            batch rsqrt() const {
+                const __m128 e = _mm_rsqrt_ps(v);
+                const __m128 refined = _mm_mul_ps(e, _mm_sub_ps(_mm_set1_ps(1.5f),
+                    _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), v), _mm_mul_ps(e, e))));
+                return { _mm_and_ps(refined, _mm_cmpgt_ps(v, _mm_setzero_ps())) };
+            }
+        };
+#else
+        struct batch {
+            float v;
+            static constexpr size_t width = 1;
+
+            static batch load(const float* p) { return { *p }; }
+            static batch broadcast(const float& f) { return { f }; }
+            void store(float* p) const { *p = v; }
+
+            batch operator+(const batch& b) const { return { v + b.v }; }
+            batch operator-(const batch& b) const { return { v - b.v }; }
+            batch operator*(const batch& b) const { return { v * b.v }; }
+
+            batch sqrt() const { return { std::sqrt(v) }; }
+            batch rsqrt() const { return { v > 0 ? 1 / std::sqrt(v) : 0 }; }
+        };
+#endif
+
+        // scalar stand-in for the tail of a loop
+        struct lane {
+            float v;
+
+            static lane load(const float* p) { return { *p }; }
+            static lane broadcast(const float& f) { return { f }; }
+            void store(float* p) const { *p = v; }
+
+            lane operator+(const lane& b) const { return { v + b.v }; }
+            lane operator-(const lane& b) const { return { v - b.v }; }
+            lane operator*(const lane& b) const { return { v * b.v }; }
+
+            lane sqrt() const { return { std::sqrt(v) }; }
+            lane rsqrt() const { return { v > 0 ? 1 / std::sqrt(v) : 0 }; }
+        };
+
+        // runs fn<batch>(i) over full registers, then fn<lane>(i) over the rest
+        template<typename F>
+        void forEach(const size_t& n, F&& fn)
+        {
+            size_t i = 0;
+            for(; i + batch::width <= n; i += batch::width) fn(batch{}, i);
+            for(; i < n; i++) fn(lane{}, i);
+        }
+    }
+
+    // lanes per register in this build
+    constexpr size_t width = detail::batch::width;
+
+    // (x, y) += (dx, dy)
+    inline void add(std::span<float> x, std::span<float> y, std::span<const float> dx, std::span<const float> dy)
+    {
+        detail::forEach(x.size(), [&]<typename B>(B, const size_t& i) {
+            (B::load(&x[i]) + B::load(&dx[i])).store(&x[i]);
+            (B::load(&y[i]) + B::load(&dy[i])).store(&y[i]);
+        });
+    }
+
+    // (x, y) *= s
+    inline void scale(std::span<float> x, std::span<float> y, const float& s)
+    {
+        detail::forEach(x.size(), [&]<typename B>(B, const size_t& i) {
+            const B k = B::broadcast(s);
+            (B::load(&x[i]) * k).store(&x[i]);
+            (B::load(&y[i]) * k).store(&y[i]);
+        });
+    }
+
+    // out = a . b
+    inline void dot(std::span<const float> ax, std::span<const float> ay, std::span<const float> bx, std::span<const float> by, std::span<float> out)
+    {
+        detail::forEach(out.size(), [&]<typename B>(B, const size_t& i) {
+            (B::load(&ax[i]) * B::load(&bx[i]) + B::load(&ay[i]) * B::load(&by[i])).store(&out[i]);
+        });
+    }
+
+    // out = a x b, the z of the 3d cross product
+    inline void cross(std::span<const float> ax, std::span<const float> ay, std::span<const float> bx, std::span<const float> by, std::span<float> out)
+    {
+        detail::forEach(out.size(), [&]<typename B>(B, const size_t& i) {
+            (B::load(&ax[i]) * B::load(&by[i]) - B::load(&ay[i]) * B::load(&bx[i])).store(&out[i]);
+        });
+    }
+
+    // rotates every vector by one angle; cos and sin are taken once
+    inline void rotate(std::span<float> x, std::span<float> y, const float& angle)
+    {
+        const float c = std::cos(angle), s = std::sin(angle);
+        detail::forEach(x.size(), [&]<typename B>(B, const size_t& i) {
+            const B vx = B::load(&x[i]), vy = B::load(&y[i]);
+            const B kc = B::broadcast(c), ks = B::broadcast(s);
+            (vx * kc - vy * ks).store(&x[i]);
+            (vx * ks + vy * kc).store(&y[i]);
+        });
+    }
+
+    // out = |(x, y)|
+    inline void length(std::span<const float> x, std::span<const float> y, std::span<float> out)
+    {
+        detail::forEach(out.size(), [&]<typename B>(B, const size_t& i) {
+            const B vx = B::load(&x[i]), vy = B::load(&y[i]);
+            (vx * vx + vy * vy).sqrt().store(&out[i]);
+        });
+    }
+
+    // scales every vector to unit length with the fast reciprocal square root
+    // (relative error around 1e-6); zero vectors stay zero
+    inline void normalize(std::span<float> x, std::span<float> y)
+    {
+        detail::forEach(x.size(), [&]<typename B>(B, const size_t& i) {
+            const B vx = B::load(&x[i]), vy = B::load(&y[i]);
+            const B inv = (vx * vx + vy * vy).rsqrt();
+            (vx * inv).store(&x[i]);
+            (vy * inv).store(&y[i]);
+        });
+    }
+
+    // (x, y) becomes (y, -x) scaled to length u, like vec2::perp(u)
+    inline void perp(std::span<float> x, std::span<float> y, const float& u)
+    {
+        detail::forEach(x.size(), [&]<typename B>(B, const size_t& i) {
+            const B vx = B::load(&x[i]), vy = B::load(&y[i]);
+            const B k = (vx * vx + vy * vy).rsqrt() * B::broadcast(u);
+            (vy * k).store(&x[i]);
+            (B::broadcast(0) - vx * k).store(&y[i]);
+        });
+    }
+
+}
+
+#endif
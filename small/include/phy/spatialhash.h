@@ -0,0 +1,226 @@
+#ifndef __PHY_SPATIAL_HASH_H__
+#define __PHY_SPATIAL_HASH_H__
+
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+
+#include "vec2.h"
+#include "geometry.h"
+#include "broadphase.h"
+
+namespace phy {
+
+    // Uniform grid for scenes whose objects are all about the same size. Objects are
+    // binned by the centre of their box into a dense cols x rows table laid over the
+    // boundary (anything outside is clamped to the edge cells). build() is a counting
+    // sort: one pass counts objects per cell, a prefix sum turns the counts into cell
+    // offsets and a second pass scatters the objects, so every cell is a contiguous
+    // slice of one array and no cell owns a container.
+    //
+    // Same resize()/insert()/getRange() surface as Quadtree<T>, plus build() once the
+    // frame's objects are in. Cell size should be at least the largest object; bigger
+    // objects still work but widen every neighbour search.
+    template<RectangularObjectConcept T>
+    class SpatialHashGrid {
+
+        public:
+            using index_type = std::uint32_t;
+            using Pair = BroadphasePair<T>;
+
+        private:
+            Rect2D boundary;
+            float cellSize = 32;
+            index_type cols = 1, rows = 1;
+            index_type reach = 1;           // neighbour rings to search, from the largest object
+            vec2 maxHalfSize;
+
+            std::vector<T*> objects;
+            std::vector<index_type> cellOf;
+            std::vector<index_type> cellStart;
+            std::vector<index_type> cursor;
+            std::vector<T*> sorted;
+
+        public:
+
+            SpatialHashGrid() = default;
+
+            void resize(const Rect2D& b, const float& cellSize)
+            {
+                boundary = b;
+                this->cellSize = std::max(cellSize, 1e-3f);
+                cols = std::max<index_type>(1, static_cast<index_type>(std::ceil(b.size.x / this->cellSize)));
+                rows = std::max<index_type>(1, static_cast<index_type>(std::ceil(b.size.y / this->cellSize)));
+                clear();
+            }
+
+            void clear() {
+                objects.clear();
+                sorted.clear();
+                cellStart.assign(size_t(cols) * rows + 1, 0);
+                maxHalfSize = { 0, 0 };
+                reach = 1;
+            }
+
+            bool insert(T* object) {
+                objects.push_back(object);
+                return true;
+            }
+
+            void build() {
+                const size_t cellCount = size_t(cols) * rows;
+                cellStart.assign(cellCount + 1, 0);
+                cellOf.resize(objects.size());
+                sorted.resize(objects.size());
+
+                maxHalfSize = { 0, 0 };
+                for(size_t i = 0; i < objects.size(); i++) {
+                    const T* object = objects[i];
+                    maxHalfSize.x = std::max(maxHalfSize.x, object->size.x * 0.5f);
+                    maxHalfSize.y = std::max(maxHalfSize.y, object->size.y * 0.5f);
+                    cellOf[i] = cellIndex(object->pos + object->size * 0.5f);
+                    cellStart[cellOf[i] + 1]++;
+                }
+                reach = std::max<index_type>(1, static_cast<index_type>(std::ceil(std::max(maxHalfSize.x, maxHalfSize.y) * 2.0f / cellSize)));
+
+                for(size_t c = 0; c < cellCount; c++) cellStart[c + 1] += cellStart[c];
+
+                cursor.assign(cellStart.begin(), cellStart.end() - 1);
+                for(size_t i = 0; i < objects.size(); i++)
+                    sorted[cursor[cellOf[i]]++] = objects[i];
+            }
+
+            void getRange(const Rect2D& range, std::vector<T*>& queried) const
+            {
+                query(range, [&](T* object) { queried.push_back(object); });
+            }
+
+            // Calls visitor(T*) for every object overlapping range; a visitor returning
+            // bool stops the search by returning false.
+            template<typename F>
+            void query(const Rect2D& range, F&& visitor) const
+            {
+                if(sorted.empty()) return;
+
+                const auto [x0, y0] = cellCoord(range.pos - maxHalfSize);
+                const auto [x1, y1] = cellCoord(range.pos + range.size + maxHalfSize);
+
+                for(index_type y = y0; y <= y1; y++) {
+                    for(index_type x = x0; x <= x1; x++) {
+                        const index_type c = y * cols + x;
+                        for(index_type i = cellStart[c]; i < cellStart[c + 1]; i++) {
+                            if(!overlaps(*sorted[i], range)) continue;
+
+                            if constexpr (std::is_same_v<std::invoke_result_t<F&, T*>, bool>) {
+                                if(!visitor(sorted[i])) return;
+                            } else {
+                                visitor(sorted[i]);
+                            }
+                        }
+                    }
+                }
+            }
+
+            // Calls visitor(T*, T*) once for every pair of overlapping boxes. Each cell is
+            // matched against itself and the half of its neighbourhood that lies ahead of
+            // it in scan order, so no pair of cells, and hence no object pair, is visited twice.
+            template<typename F>
+            void forEachPair(F&& visitor) const
+            {
+                const int r = static_cast<int>(reach);
+
+                for(index_type y = 0; y < rows; y++) {
+                    for(index_type x = 0; x < cols; x++) {
+                        const index_type c = y * cols + x;
+                        const index_type begin = cellStart[c], end = cellStart[c + 1];
+                        if(begin == end) continue;
+
+                        for(index_type i = begin; i < end; i++) {
+                            for(index_type j = i + 1; j < end; j++) {
+                                if(overlaps(*sorted[i], *sorted[j])) visitor(sorted[i], sorted[j]);
+                            }
+                        }
+
+                        for(int dy = 0; dy <= r; dy++) {
+                            const int ny = int(y) + dy;
+                            if(ny >= int(rows)) break;
+
+                            for(int dx = (dy == 0 ? 1 : -r); dx <= r; dx++) {
+                                const int nx = int(x) + dx;
+                                if(nx < 0 || nx >= int(cols)) continue;
+
+                                const index_type n = index_type(ny) * cols + index_type(nx);
+                                for(index_type i = begin; i < end; i++) {
+                                    for(index_type j = cellStart[n]; j < cellStart[n + 1]; j++) {
+                                        if(overlaps(*sorted[i], *sorted[j])) visitor(sorted[i], sorted[j]);
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+            // appends every overlapping pair to pairs (cleared first)
+            void getPairs(std::vector<Pair>& pairs) const
+            {
+                pairs.clear();
+                forEachPair([&](T* a, T* b) { pairs.push_back(Pair{ a, b }); });
+            }
+
+            // objects binned into one cell, valid until the next build()
+            std::span<T* const> getCell(const index_type& x, const index_type& y) const {
+                const index_type c = y * cols + x;
+                return { sorted.data() + cellStart[c], cellStart[c + 1] - cellStart[c] };
+            }
+
+            index_type getCols() const {
+                return cols;
+            }
+
+            index_type getRows() const {
+                return rows;
+            }
+
+            float getCellSize() const {
+                return cellSize;
+            }
+
+            const Rect2D& getBoundary() const {
+                return boundary;
+            }
+
+            size_t size() const {
+                return objects.size();
+            }
+
+        private:
+            std::pair<index_type, index_type> cellCoord(const vec2& p) const {
+                const float fx = std::floor((p.x - boundary.pos.x) / cellSize);
+                const float fy = std::floor((p.y - boundary.pos.y) / cellSize);
+                return {
+                    static_cast<index_type>(std::clamp(fx, 0.0f, float(cols - 1))),
+                    static_cast<index_type>(std::clamp(fy, 0.0f, float(rows - 1)))
+                };
+            }
+
+            index_type cellIndex(const vec2& p) const {
+                const auto [x, y] = cellCoord(p);
+                return y * cols + x;
+            }
+
+            template<RectangularObjectConcept A, RectangularObjectConcept B>
+            static constexpr bool overlaps(const A& a, const B& b)
+            {
+                return (a.pos.x < b.pos.x + b.size.x && a.pos.x + a.size.x > b.pos.x &&
+                    a.pos.y < b.pos.y + b.size.y && a.pos.y + a.size.y > b.pos.y);
+            }
+    };
+
+}
+
+#endif
\ No newline at end of file
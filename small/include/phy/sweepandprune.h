@@ -0,0 +1,156 @@
+#ifndef __PHY_SWEEP_AND_PRUNE_H__
+#define __PHY_SWEEP_AND_PRUNE_H__
+
+#include <vector>
+#include <cstdint>
+
+#include "vec2.h"
+#include "geometry.h"
+#include "broadphase.h"
+
+namespace phy {
+
+    // Sort-and-sweep broadphase on the x axis. Each proxy keeps one entry in an endpoint
+    // list ordered by its left edge, and the list survives between frames. update()
+    // pulls in the new bounds and re-sorts with insertion sort. Bodies only drift a
+    // little per step, so that sort is close to O(n). The sweep then walks the list and
+    // tests y only for entries whose x spans overlap, writing hits into a flat pair buffer.
+    //
+    // Proxies flagged static (walls, pockets) are never paired with each other.
+    template<typename T>
+    class SweepAndPrune {
+
+        public:
+            using index_type = std::uint32_t;
+            using Pair = BroadphasePair<T>;
+            static constexpr index_type npos = ~index_type(0);
+
+        private:
+            struct Proxy {
+                Rect2D bounds;
+                T* object = nullptr;
+                bool isStatic = false;
+                index_type nextFree = npos;
+            };
+
+            // bounds are copied in so the sweep never leaves this array
+            struct Endpoint {
+                float minX, maxX, minY, maxY;
+                index_type proxy;
+                bool isStatic;
+            };
+
+            std::vector<Proxy> proxies;
+            std::vector<Endpoint> endpoints;
+            std::vector<Pair> pairs;
+            index_type freeProxy = npos;
+
+        public:
+
+            SweepAndPrune() = default;
+
+            index_type add(T* object, const Rect2D& bounds, const bool& isStatic = false)
+            {
+                index_type id = freeProxy;
+                if(id != npos) {
+                    freeProxy = proxies[id].nextFree;
+                } else {
+                    id = static_cast<index_type>(proxies.size());
+                    proxies.emplace_back();
+                }
+                proxies[id] = Proxy{ bounds, object, isStatic, npos };
+
+                // new proxies go in at the right spot so the list stays sorted
+                Endpoint endpoint = makeEndpoint(id);
+                size_t i = endpoints.size();
+                endpoints.push_back(endpoint);
+                while(i > 0 && endpoints[i - 1].minX > endpoint.minX) {
+                    endpoints[i] = endpoints[i - 1];
+                    i--;
+                }
+                endpoints[i] = endpoint;
+                return id;
+            }
+
+            void remove(const index_type& id)
+            {
+                for(size_t i = 0; i < endpoints.size(); i++) {
+                    if(endpoints[i].proxy != id) continue;
+                    endpoints.erase(endpoints.begin() + i);
+                    break;
+                }
+                proxies[id].object = nullptr;
+                proxies[id].nextFree = freeProxy;
+                freeProxy = id;
+            }
+
+            void move(const index_type& id, const Rect2D& bounds)
+            {
+                proxies[id].bounds = bounds;
+            }
+
+            // static proxies are only paired with dynamic ones, e.g. for sleeping bodies
+            void setStatic(const index_type& id, const bool& isStatic)
+            {
+                proxies[id].isStatic = isStatic;
+            }
+
+            // Refreshes the endpoint list from the proxies, re-sorts it and rebuilds the
+            // pair buffer.
+            void update()
+            {
+                for(auto& endpoint: endpoints) {
+                    const Rect2D& b = proxies[endpoint.proxy].bounds;
+                    endpoint.minX = b.pos.x;
+                    endpoint.maxX = b.pos.x + b.size.x;
+                    endpoint.minY = b.pos.y;
+                    endpoint.maxY = b.pos.y + b.size.y;
+                    endpoint.isStatic = proxies[endpoint.proxy].isStatic;
+                }
+
+                for(size_t i = 1; i < endpoints.size(); i++) {
+                    const Endpoint endpoint = endpoints[i];
+                    size_t j = i;
+                    while(j > 0 && endpoints[j - 1].minX > endpoint.minX) {
+                        endpoints[j] = endpoints[j - 1];
+                        j--;
+                    }
+                    endpoints[j] = endpoint;
+                }
+
+                pairs.clear();
+                for(size_t i = 0; i < endpoints.size(); i++) {
+                    const Endpoint& a = endpoints[i];
+                    for(size_t j = i + 1; j < endpoints.size() && endpoints[j].minX < a.maxX; j++) {
+                        const Endpoint& b = endpoints[j];
+                        if(a.isStatic && b.isStatic) continue;
+                        if(b.maxX <= a.minX || a.minY >= b.maxY || b.minY >= a.maxY) continue;
+                        pairs.push_back(Pair{ proxies[a.proxy].object, proxies[b.proxy].object });
+                    }
+                }
+            }
+
+            // overlapping pairs found by the last update()
+            const std::vector<Pair>& getPairs() const {
+                return pairs;
+            }
+
+            const Rect2D& getBounds(const index_type& id) const {
+                return proxies[id].bounds;
+            }
+
+            size_t size() const {
+                return endpoints.size();
+            }
+
+        private:
+            Endpoint makeEndpoint(const index_type& id) const {
+                const Proxy& p = proxies[id];
+                return Endpoint{ p.bounds.pos.x, p.bounds.pos.x + p.bounds.size.x,
+                    p.bounds.pos.y, p.bounds.pos.y + p.bounds.size.y, id, p.isStatic };
+            }
+    };
+
+}
+
+#endif
\ No newline at end of file
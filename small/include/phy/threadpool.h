@@ -0,0 +1,115 @@
+#ifndef __PHY_THREAD_POOL_H__
+#define __PHY_THREAD_POOL_H__
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+
+namespace phy {
+
+    // Fixed set of worker threads for fork-join loops. parallelFor() publishes one job,
+    // wakes the workers, runs on the calling thread as well and returns once every index
+    // is done. Indices are handed out through one atomic counter, so uneven tasks balance
+    // themselves. Only one parallelFor() may run at a time.
+    class ThreadPool {
+
+        private:
+            std::vector<std::thread> workers;
+            std::mutex mutex;
+            std::condition_variable wake, done;
+
+            void* context = nullptr;
+            void (*invoke)(void*, size_t) = nullptr;
+            size_t jobCount = 0;
+            std::atomic<size_t> next{ 0 };
+            size_t generation = 0;
+            size_t busy = 0;
+            bool stopping = false;
+
+        public:
+
+            // threads counts the calling thread; 0 picks one per hardware thread
+            explicit ThreadPool(unsigned threads = 0)
+            {
+                if(threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+                for(unsigned i = 1; i < threads; i++)
+                    workers.emplace_back([this] { workerLoop(); });
+            }
+
+            ~ThreadPool()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stopping = true;
+                }
+                wake.notify_all();
+                for(auto& worker: workers) worker.join();
+            }
+
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
+
+            // threads taking part in parallelFor(), the caller included
+            size_t size() const {
+                return workers.size() + 1;
+            }
+
+            // calls fn(i) for every i in [0, count) and blocks until all calls returned
+            template<typename F>
+            void parallelFor(const size_t& count, F&& fn)
+            {
+                if(count == 0) return;
+                if(workers.empty() || count == 1) {
+                    for(size_t i = 0; i < count; i++) fn(i);
+                    return;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    context = &fn;
+                    invoke = [](void* ctx, size_t i) { (*static_cast<std::remove_reference_t<F>*>(ctx))(i); };
+                    jobCount = count;
+                    next.store(0, std::memory_order_relaxed);
+                    busy = workers.size();
+                    generation++;
+                }
+                wake.notify_all();
+
+                run();
+
+                std::unique_lock<std::mutex> lock(mutex);
+                done.wait(lock, [this] { return busy == 0; });
+            }
+
+        private:
+            void run() {
+                for(size_t i = next.fetch_add(1); i < jobCount; i = next.fetch_add(1))
+                    invoke(context, i);
+            }
+
+            void workerLoop() {
+                size_t seen = 0;
+                while(true) {
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        wake.wait(lock, [&] { return stopping || generation != seen; });
+                        if(stopping) return;
+                        seen = generation;
+                    }
+
+                    run();
+
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if(--busy == 0) done.notify_one();
+                }
+            }
+    };
+
+}
+
+#endif
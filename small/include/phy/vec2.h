@@ -40,10 +40,14 @@ namespace phy {
         }
 
         vec2 rotate(const float& angle) {
-            return {
-                x * std::cos(angle) - y * std::sin(angle),
-                x * std::sin(angle) + y * std::cos(angle)
-            };
+            const float c = std::cos(angle), s = std::sin(angle);
+            return { x * c - y * s, x * s + y * c };
+        }
+
+        // rotates by the unit complex number r = (cos a, sin a), e.g. from fromAngle(a);
+        // applying one rotor to another composes them
+        vec2 applyRotor(const vec2& r) const {
+            return { x * r.x - y * r.y, x * r.y + y * r.x };
         }
 
         vec2 perp(const float& u, const bool anticlockwise = true) const {
@@ -70,7 +74,7 @@ namespace phy {
         }
 
         float length() {
-            return std::hypot(x, y);
+            return std::sqrt(x * x + y * y);
         }
 
         vec2 normalize() {
@@ -0,0 +1,253 @@
+#ifndef __PHY_XPBD_H__
+#define __PHY_XPBD_H__
+
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <cmath>
+#include <numbers>
+
+#include "vec2.h"
+#include "constraintgraph.h"
+#include "threadpool.h"
+
+namespace phy {
+
+    // Extended position-based dynamics. Every constraint has a compliance (inverse
+    // stiffness, 0 = rigid) and a Lagrange multiplier that accumulates over the
+    // iterations of a substep, so the stiffness you get is set by the compliance alone,
+    // not by the iteration count or the timestep. Call solve() once per substep, after
+    // predicting positions; several short substeps with one iteration each converge
+    // better than one long step with many iterations.
+    //
+    // Positions (vec2, or separate x and y arrays) and inverse masses are passed in as
+    // spans indexed like the constraints; an inverse mass of 0 pins a particle.
+    class XPBDSolver {
+
+        public:
+            using index_type = std::uint32_t;
+
+        private:
+            struct Distance {
+                index_type a, b;
+                float rest, compliance;
+                float lambda = 0;
+            };
+
+            // signed angle at b from (a - b) to (c - b)
+            struct Bending {
+                index_type a, b, c;
+                float rest, compliance;
+                float lambda = 0;
+            };
+
+            // signed area of the closed loop indices[first, first + count)
+            struct Area {
+                index_type first, count;
+                float rest, compliance;
+                float lambda = 0;
+            };
+
+            std::vector<Distance> distances;
+            std::vector<Bending> bendings;
+            std::vector<Area> areas;
+            std::vector<index_type> areaIndices;
+            std::vector<ConstraintGraph::edge_type> distanceEnds;
+            ConstraintGraph graph;
+            bool graphDirty = false;
+            std::vector<vec2> gradients;    // scratch for area constraints
+
+        public:
+            int iterations = 1;
+
+            XPBDSolver() = default;
+
+            void clear() {
+                distances.clear();
+                bendings.clear();
+                areas.clear();
+                areaIndices.clear();
+                distanceEnds.clear();
+                graphDirty = true;
+            }
+
+            void addDistance(const index_type& a, const index_type& b, const float& rest, const float& compliance = 0) {
+                distances.push_back({ a, b, rest, compliance });
+                distanceEnds.push_back({ a, b });
+                graphDirty = true;
+            }
+
+            void addBending(const index_type& a, const index_type& b, const index_type& c, const float& rest, const float& compliance = 0) {
+                bendings.push_back({ a, b, c, rest, compliance });
+            }
+
+            // keeps the area enclosed by loop at rest (positive when the loop runs
+            // counter-clockwise with y up, clockwise on screen)
+            void addArea(std::span<const index_type> loop, const float& rest, const float& compliance = 0) {
+                areas.push_back({ static_cast<index_type>(areaIndices.size()), static_cast<index_type>(loop.size()), rest, compliance });
+                areaIndices.insert(areaIndices.end(), loop.begin(), loop.end());
+            }
+
+            // current values, e.g. to pick rest states from an initial pose
+            static float angle(std::span<const vec2> pos, const index_type& a, const index_type& b, const index_type& c) {
+                return angleOf(vec2Positions<const vec2>{ pos }, a, b, c);
+            }
+
+            static float area(std::span<const vec2> pos, std::span<const index_type> loop) {
+                return areaOf(vec2Positions<const vec2>{ pos }, loop);
+            }
+
+            static float area(std::span<const float> x, std::span<const float> y, std::span<const index_type> loop) {
+                return areaOf(splitPositions<const float>{ x, y }, loop);
+            }
+
+            // One substep of length h. Distance constraints run color by color, over pool
+            // when given; bending and area constraints run serially after them.
+            void solve(std::span<vec2> pos, std::span<const float> invMass, const float& h, ThreadPool* pool = nullptr) {
+                solvePositions(vec2Positions<vec2>{ pos }, invMass, h, pool);
+            }
+
+            // same, for positions stored as separate x and y arrays
+            void solve(std::span<float> x, std::span<float> y, std::span<const float> invMass, const float& h, ThreadPool* pool = nullptr) {
+                solvePositions(splitPositions<float>{ x, y }, invMass, h, pool);
+            }
+
+            size_t size() const {
+                return distances.size() + bendings.size() + areas.size();
+            }
+
+        private:
+            // the two position layouts the constraints can work on
+            template<typename V>
+            struct vec2Positions {
+                std::span<V> p;
+                size_t size() const { return p.size(); }
+                vec2 get(const size_t& i) const { return p[i]; }
+                void add(const size_t& i, const vec2& d) const { p[i] += d; }
+            };
+
+            template<typename F>
+            struct splitPositions {
+                std::span<F> x, y;
+                size_t size() const { return x.size(); }
+                vec2 get(const size_t& i) const { return { x[i], y[i] }; }
+                void add(const size_t& i, const vec2& d) const { x[i] += d.x; y[i] += d.y; }
+            };
+
+            template<typename P>
+            static float angleOf(const P& pos, const index_type& a, const index_type& b, const index_type& c) {
+                const vec2 u = pos.get(a) - pos.get(b), v = pos.get(c) - pos.get(b);
+                return std::atan2(u.x * v.y - u.y * v.x, u.x * v.x + u.y * v.y);
+            }
+
+            template<typename P>
+            static float areaOf(const P& pos, std::span<const index_type> loop) {
+                float sum = 0;
+                for(size_t i = 0; i < loop.size(); i++) {
+                    const vec2 p = pos.get(loop[i]);
+                    const vec2 q = pos.get(loop[(i + 1) % loop.size()]);
+                    sum += p.x * q.y - p.y * q.x;
+                }
+                return sum * 0.5f;
+            }
+
+            template<typename P>
+            void solvePositions(const P& pos, std::span<const float> invMass, const float& h, ThreadPool* pool)
+            {
+                if(h <= 0) return;
+                if(graphDirty) {
+                    graph.build(distanceEnds, pos.size());
+                    graphDirty = false;
+                }
+
+                for(auto& c: distances) c.lambda = 0;
+                for(auto& c: bendings) c.lambda = 0;
+                for(auto& c: areas) c.lambda = 0;
+
+                const float invH2 = 1.0f / (h * h);
+                for(int iteration = 0; iteration < iterations; iteration++) {
+                    graph.solve([&](const index_type& i) { solveDistance(distances[i], pos, invMass, invH2); }, pool);
+                    for(auto& c: bendings) solveBending(c, pos, invMass, invH2);
+                    for(auto& c: areas) solveArea(c, pos, invMass, invH2);
+                }
+            }
+
+            template<typename P>
+            static void solveDistance(Distance& c, const P& pos, std::span<const float> invMass, const float& invH2)
+            {
+                const float wA = invMass[c.a], wB = invMass[c.b];
+                const vec2 delta = pos.get(c.a) - pos.get(c.b);
+                const float length = std::sqrt(delta.x * delta.x + delta.y * delta.y);
+                const float alpha = c.compliance * invH2;
+                if(length == 0 || wA + wB + alpha == 0) return;
+
+                const vec2 n = delta * (1.0f / length);
+                const float dLambda = (-(length - c.rest) - alpha * c.lambda) / (wA + wB + alpha);
+                c.lambda += dLambda;
+                pos.add(c.a, n * (wA * dLambda));
+                pos.add(c.b, n * (-wB * dLambda));
+            }
+
+            template<typename P>
+            static void solveBending(Bending& c, const P& pos, std::span<const float> invMass, const float& invH2)
+            {
+                const vec2 u = pos.get(c.a) - pos.get(c.b), v = pos.get(c.c) - pos.get(c.b);
+                const float uu = u.x * u.x + u.y * u.y, vv = v.x * v.x + v.y * v.y;
+                if(uu == 0 || vv == 0) return;
+
+                float error = std::atan2(u.x * v.y - u.y * v.x, u.x * v.x + u.y * v.y) - c.rest;
+                if(error > pi) error -= 2 * pi;
+                if(error < -pi) error += 2 * pi;
+
+                // d(angle)/da and d(angle)/dc; b moves against both
+                const vec2 gA{ u.y / uu, -u.x / uu };
+                const vec2 gC{ -v.y / vv, v.x / vv };
+                const vec2 gB = (gA + gC) * -1.0f;
+
+                const float wA = invMass[c.a], wB = invMass[c.b], wC = invMass[c.c];
+                const float alpha = c.compliance * invH2;
+                const float denominator = wA * dot(gA, gA) + wB * dot(gB, gB) + wC * dot(gC, gC) + alpha;
+                if(denominator == 0) return;
+
+                const float dLambda = (-error - alpha * c.lambda) / denominator;
+                c.lambda += dLambda;
+                pos.add(c.a, gA * (wA * dLambda));
+                pos.add(c.b, gB * (wB * dLambda));
+                pos.add(c.c, gC * (wC * dLambda));
+            }
+
+            template<typename P>
+            void solveArea(Area& c, const P& pos, std::span<const float> invMass, const float& invH2)
+            {
+                const std::span<const index_type> loop(areaIndices.data() + c.first, c.count);
+                const size_t n = loop.size();
+                if(n < 3) return;
+
+                // dA/dp_i = 0.5 * perp(p_{i+1} - p_{i-1}), all taken before any point moves
+                const float alpha = c.compliance * invH2;
+                float denominator = alpha;
+                gradients.resize(n);
+                for(size_t i = 0; i < n; i++) {
+                    const vec2 next = pos.get(loop[(i + 1) % n]);
+                    const vec2 prev = pos.get(loop[(i + n - 1) % n]);
+                    gradients[i] = { (next.y - prev.y) * 0.5f, (prev.x - next.x) * 0.5f };
+                    denominator += invMass[loop[i]] * dot(gradients[i], gradients[i]);
+                }
+                if(denominator == 0) return;
+
+                const float dLambda = (-(areaOf(pos, loop) - c.rest) - alpha * c.lambda) / denominator;
+                c.lambda += dLambda;
+                for(size_t i = 0; i < n; i++)
+                    pos.add(loop[i], gradients[i] * (invMass[loop[i]] * dLambda));
+            }
+
+            static float dot(const vec2& p, const vec2& q) {
+                return p.x * q.x + p.y * q.y;
+            }
+
+            static constexpr float pi = std::numbers::pi_v<float>;
+    };
+
+}
+
+#endif
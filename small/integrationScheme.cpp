@@ -9,6 +9,7 @@ TODO: once ball rect has intersect with a static ball, just ignore other collisi
 #include <SDL3/SDL.h>
 
 #include "./include/phy/vec2.h"
+#include "./include/phy/integrator.h"
 
 constexpr int W = 640;
 constexpr int H = 480;
@@ -51,21 +52,7 @@ phy::vec2 calcAcc(const phy::vec2& vel) {
 void physicsProcess(const float& dt)
 {
 	// runge-kutta (RK4) scheme
-	auto p1 = pos;
-	auto v1 = vel;
-	auto a1 = calcAcc(v1);
-	auto p2 = p1 + v1 * (dt * 0.5f);
-	auto v2 = v1 + a1 * (dt * 0.5f);
-	auto a2 = calcAcc(v2);
-	auto p3 = p1 + v2 * (dt * 0.5f);
-	auto v3 = v1 + a2 * (dt * 0.5f);
-	auto a3 = calcAcc(v3);
-	auto p4 = p1 + v3 * dt;
-	auto v4 = v1 + a3 * dt;
-	auto a4 = calcAcc(v4);
-
-	pos += (v1 + v2 * 2.0f + v3 * 2.0f + v4) * (dt / 6.0f);
-	vel += (a1 + a2 * 2.0f + a3 * 2.0f + a4) * (dt / 6.0f);
+	phy::integrator::rk4(pos, vel, dt, [](const phy::vec2&, const phy::vec2& v) { return calcAcc(v); });
 
 	if(pos.y + radius > H) {
 		pos.y = H - radius;
@@ -67,7 +67,6 @@ void init()
 	polygons.push_back(p1);
 
 	p1.pos.x -= 100;
-	p1.setRotation(0);
 	polygons.push_back(p1);
 
     t0 = std::chrono::high_resolution_clock::now().time_since_epoch();
@@ -87,28 +86,26 @@ bool satCollision(phy::polygon& poly1, phy::polygon& poly2, collisionInfo& minCo
 			polygon2 = &poly1;
 		}
 
-		for(int i = 0; i < polygon1->vertices.size(); i++)
+		const auto& world1 = polygon1->getWorldVertices();
+		const auto& world2 = polygon2->getWorldVertices();
+		const auto& normals = polygon1->getEdgeNormals();
+
+		for(int i = 0; i < world1.size(); i++)
 		{
-			auto rotation = polygon1->getRotation();
-			auto p1 = polygon1->pos + polygon1->vertices[i].rotate(rotation);
-			auto p2 = polygon1->pos + polygon1->vertices[(i + 1) % polygon1->vertices.size()].rotate(rotation);
-			auto edge = (p2 - p1).normalize();
-			auto normal = edge.perp(1).normalize();
+			auto normal = normals[i];
 
 			float minA = INFINITY, maxA = -INFINITY;
 			float minB = INFINITY, maxB = -INFINITY;
 
-			for(int i = 0; i < polygon1->vertices.size(); i++)
+			for(auto pos: world1)
 			{
-				auto pos = polygon1->pos + polygon1->vertices[i].rotate(polygon1->getRotation());
 				auto dp = pos.dotProduct(normal);
 				minA = std::min(dp, minA);
 				maxA = std::max(dp, maxA);
 			}
 
-			for(int i = 0; i < polygon2->vertices.size(); i++)
+			for(auto pos: world2)
 			{
-				auto pos = polygon2->pos + polygon2->vertices[i].rotate(polygon2->getRotation());
 				auto dp = pos.dotProduct(normal);
 				minB = std::min(dp, minB);
 				maxB = std::max(dp, maxB);
@@ -148,13 +145,17 @@ bool checkPolygonCollision(phy::polygon& poly1, phy::polygon& poly2, collisionIn
 			polygon2 = &poly1;
 		}
 
-		for(int i = 0; i < polygon1->vertices.size(); i++) {
+		const auto& world1 = polygon1->getWorldVertices();
+		const auto& world2 = polygon2->getWorldVertices();
+		const auto& normals2 = polygon2->getEdgeNormals();
+
+		for(int i = 0; i < world1.size(); i++) {
 			auto l1 = polygon1->pos;
-			auto l2 = l1 + polygon1->vertices[i].rotate(polygon1->getRotation());
+			auto l2 = world1[i];
 
-			for(int j = 0; j < polygon2->vertices.size(); j++) {
-				auto l3 = polygon2->pos + polygon2->vertices[j].rotate(polygon2->getRotation());
-				auto l4 = polygon2->pos + polygon2->vertices[(j+1)%polygon2->vertices.size()].rotate(polygon2->getRotation());
+			for(int j = 0; j < world2.size(); j++) {
+				auto l3 = world2[j];
+				auto l4 = world2[(j+1)%world2.size()];
 
 				float denom = (l1.x - l2.x) * (l3.y - l4.y) - (l1.y - l2.y) * (l3.x - l4.x);
 				float t = ((l1.x - l3.x) * (l3.y - l4.y) - (l1.y - l3.y) * (l3.x - l4.x)) / denom;
@@ -166,7 +167,7 @@ bool checkPolygonCollision(phy::polygon& poly1, phy::polygon& poly2, collisionIn
 					if(d < minLength) {
 						minLength = d;
 						minCollision.depth = d;
-						minCollision.edge = (l4 - l3).normalize().perp(1);
+						minCollision.edge = normals2[j];
 						hasCollided = true;
 					}
 				}
@@ -331,9 +332,10 @@ void drawFilledCircle(SDL_Renderer* r, float px, float py, float radius)
 
 void renderPolygon(phy::polygon &polygon)
 {
-	for(int i = 0; i < polygon.vertices.size(); i++) {
-		auto v1 = polygon.pos + polygon.vertices[i].rotate(polygon.getRotation());
-		auto v2 = polygon.pos + polygon.vertices[(i+1)%polygon.vertices.size()].rotate(polygon.getRotation());
+	const auto& world = polygon.getWorldVertices();
+	for(int i = 0; i < world.size(); i++) {
+		auto& v1 = world[i];
+		auto& v2 = world[(i+1)%world.size()];
 		SDL_RenderLine(renderer, v1.x, v1.y, v2.x, v2.y);
 	}
 }
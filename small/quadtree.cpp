@@ -5,9 +5,11 @@
 #include <chrono>
 #include <random>
 #include <memory>
+#include <cmath>
 
 #include "./include/phy/geometry.h"
 #include "./include/phy/quadtree.h"
+#include "./include/phy/threadpool.h"
 
 using namespace std;
 
@@ -19,10 +21,11 @@ std::chrono::high_resolution_clock::duration t0;
 float randRange(const float& min, const float& max);
 bool processEvent(SDL_Event& evt);
 void makeBlock(const float& x, const float& y, const float& w, const float& h);
+void rebuildTree();
 void drawFilledCircle(SDL_Renderer* r, float px, float py, float radius);
 
 template<typename T>
-void renderQuadtree(SDL_Renderer* renderer, const phy::Quadtree<T>& qtree);
+void renderQuadtree(SDL_Renderer* renderer, const phy::Quadtree<T>& qtree, const typename phy::Quadtree<T>::Node& node);
 
 bool pointInRect(const SDL_FPoint& point, const SDL_FRect& rect);
 bool rectToRectIntersect(const SDL_FRect& a, const SDL_FRect& b);
@@ -30,8 +33,12 @@ bool rectToRectIntersect(const SDL_FRect& a, const SDL_FRect& b);
 std::vector<phy::Rect2D> objects;
 std::vector<SDL_Color> colors;
 phy::Quadtree<phy::Rect2D> qtree;
+phy::ThreadPool pool;
+std::vector<phy::Rect2D*> objectPointers;
 std::vector<phy::Rect2D*> queried;
 phy::Rect2D range;
+std::vector<phy::Ray2D> rays(64);
+std::vector<phy::Quadtree<phy::Rect2D>::RayHit> rayHits(64);
 
 
 void init()
@@ -40,17 +47,24 @@ void init()
     for(int i = 0; i < 1000; i++) {
         makeBlock(randRange(0, W - 30), randRange(0, H - 30), randRange(15, 30), randRange(15, 30));
     }
+    rebuildTree();
 
     t0 = std::chrono::high_resolution_clock::now().time_since_epoch();
 }
 
 void update(float dt, SDL_Renderer* renderer)
 {
-	qtree.resize(phy::Rect2D{ {0.0f, 0.0f}, {W, H} }, 4, 500);
-	for(auto& obj: objects) qtree.insert(&obj);
-
+	// blocks only move when one is added, so the tree is kept between frames
 	queried.clear();
 	qtree.getRange(range, queried);
+
+	// line of sight from the cursor: a fan of rays, each stopping at the first block
+	const phy::vec2 eye = range.pos + range.size * 0.5f;
+	for(int i = 0; i < rays.size(); i++) {
+		const float angle = i * 2.0f * 3.14159f / rays.size();
+		rays[i] = phy::Ray2D{ eye, { std::cos(angle), std::sin(angle) }, 300.0f };
+	}
+	qtree.raycast(rays, rayHits);
 }
 
 void render(SDL_Renderer* renderer)
@@ -64,7 +78,7 @@ void render(SDL_Renderer* renderer)
 		SDL_RenderFillRect(renderer, &rect);
 	}
 
-	renderQuadtree(renderer, qtree);
+	renderQuadtree(renderer, qtree, qtree.getRoot());
 
 	for(auto& obj: queried)
 	{
@@ -73,6 +87,13 @@ void render(SDL_Renderer* renderer)
 		SDL_RenderFillRect(renderer, &rect);
 	}
 
+	SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
+	for(int i = 0; i < rays.size(); i++) {
+		auto& ray = rays[i];
+		const float t = rayHits[i].object ? rayHits[i].t : ray.maxT;
+		SDL_RenderLine(renderer, ray.origin.x, ray.origin.y, ray.origin.x + ray.dir.x * t, ray.origin.y + ray.dir.y * t);
+	}
+
 	SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);
 	SDL_FRect rect{ range.pos.x, range.pos.y, range.size.x, range.size.y };
 	SDL_RenderRect(renderer, &rect);
@@ -97,6 +118,7 @@ bool processEvent(SDL_Event& evt) {
             const float px = evt.motion.x;
             const float py = evt.motion.y;
             makeBlock(px, py, randRange(20, 50), randRange(20, 50));
+            rebuildTree();      // push_back may have moved every block
             break;
 	}
 	return false;
@@ -197,15 +219,15 @@ bool pointInRect(const SDL_FPoint &point, const SDL_FRect &rect)
 
 
 template<typename T>
-void renderQuadtree(SDL_Renderer* renderer, const phy::Quadtree<T>& qtree)
+void renderQuadtree(SDL_Renderer* renderer, const phy::Quadtree<T>& qtree, const typename phy::Quadtree<T>::Node& node)
 {
     SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-    auto& boundary = qtree.getBoundary();
+    auto& boundary = node.boundary;
     SDL_FRect rect = { boundary.pos.x, boundary.pos.y, boundary.size.x, boundary.size.y };
     SDL_RenderRect(renderer, &rect);
 
-    for(auto& child: qtree.getChildren()) {
-        renderQuadtree(renderer, *child);
+    for(auto& child: qtree.getChildren(node)) {
+        renderQuadtree(renderer, qtree, child);
     }
 
 }
@@ -220,3 +242,13 @@ void makeBlock(const float& x, const float& y, const float& w, const float& h)
     objects.push_back(rect);
     colors.push_back(SDL_Color{ (unsigned char)randRange(0, 255), (unsigned char)randRange(0, 255), (unsigned char)randRange(0, 255) });
 }
+
+
+void rebuildTree()
+{
+	objectPointers.clear();
+	for(auto& obj: objects) objectPointers.push_back(&obj);
+
+	qtree.resize(phy::Rect2D{ {0.0f, 0.0f}, {W, H} }, 4, 500);
+	qtree.build(objectPointers, &pool);
+}
\ No newline at end of file
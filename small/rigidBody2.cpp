@@ -89,13 +89,16 @@ bool checkPolygonCollision(phy::polygon& poly1, phy::polygon& poly2, collisionIn
 			polygon2 = &poly1;
 		}
 
-		for(int i = 0; i < polygon1->vertices.size(); i++) {
+		const auto& world1 = polygon1->getWorldVertices();
+		const auto& world2 = polygon2->getWorldVertices();
+
+		for(int i = 0; i < world1.size(); i++) {
 			auto l1 = polygon1->pos;
-			auto l2 = l1 + polygon1->vertices[i].rotate(polygon1->getRotation());
+			auto l2 = world1[i];
 
-			for(int j = 0; j < polygon2->vertices.size(); j++) {
-				auto l3 = polygon2->pos + polygon2->vertices[j].rotate(polygon2->getRotation());
-				auto l4 = polygon2->pos + polygon2->vertices[(j+1)%polygon2->vertices.size()].rotate(polygon2->getRotation());
+			for(int j = 0; j < world2.size(); j++) {
+				auto l3 = world2[j];
+				auto l4 = world2[(j+1)%world2.size()];
 
 				float denom = (l1.x - l2.x) * (l3.y - l4.y) - (l1.y - l2.y) * (l3.x - l4.x);
 				float t = ((l1.x - l3.x) * (l3.y - l4.y) - (l1.y - l3.y) * (l3.x - l4.x)) / denom;
@@ -185,7 +188,7 @@ void update(float dt, SDL_Renderer* renderer)
 		}	// collision detection ends
 
 		polygon.pos += polygon.vel * dt;
-		polygon.setRotation(polygon.angVelo * dt);
+		polygon.rotate(polygon.angVelo * dt);
 		
 		checkWallBounce(polygon);
 
@@ -315,9 +318,10 @@ void drawFilledCircle(SDL_Renderer* r, float px, float py, float radius)
 
 void renderPolygon(phy::polygon &polygon)
 {
-	for(int i = 0; i < polygon.vertices.size(); i++) {
-		auto v1 = polygon.pos + polygon.vertices[i].rotate(polygon.getRotation());
-		auto v2 = polygon.pos + polygon.vertices[(i+1)%polygon.vertices.size()].rotate(polygon.getRotation());
+	const auto& world = polygon.getWorldVertices();
+	for(int i = 0; i < world.size(); i++) {
+		auto& v1 = world[i];
+		auto& v2 = world[(i+1)%world.size()];
 		SDL_RenderLine(renderer, v1.x, v1.y, v2.x, v2.y);
 	}
 }
@@ -326,8 +330,9 @@ void checkWallBounce(phy::polygon &poly)
 {
 	int j, j2;
 	bool testCollision = false, testCollision2 = false;
-	for(int i = 0; i < poly.vertices.size(); i++) {
-		const auto v = poly.pos + poly.vertices[i].rotate(poly.getRotation());
+	const auto& world = poly.getWorldVertices();
+	for(int i = 0; i < world.size(); i++) {
+		const auto& v = world[i];
 		if(v.y > FLOOR) {
 			if(testCollision == false) {
 				j = i;
@@ -342,15 +347,14 @@ void checkWallBounce(phy::polygon &poly)
 	}
 
 	if(testCollision) {
-		float rotation = poly.getRotation();
-		poly.pos.y -= poly.pos.y + poly.vertices[j].rotate(rotation).y - FLOOR;
+		poly.pos.y -= poly.pos.y + poly.vertices[j].applyRotor(poly.rotor).y - FLOOR;
 		if(testCollision2) {
-			poly.pos.y -= poly.pos.y + poly.vertices[j2].rotate(rotation).y - FLOOR;
+			poly.pos.y -= poly.pos.y + poly.vertices[j2].applyRotor(poly.rotor).y - FLOOR;
 			testCollision2 = false;
 		}
 
 		phy::vec2 normal { 0, -1 };
-		auto rp1 = poly.vertices[j].rotate(rotation);
+		auto rp1 = poly.vertices[j].applyRotor(poly.rotor);
 		auto vp1 = poly.vel + rp1.perp(-poly.angVelo*rp1.length());
 		auto rp1Xnormal = rp1.crossProduct(normal);
 		auto impulse = -(1+cr)*vp1.dotProduct(normal)/(1/poly.mass + rp1Xnormal*rp1Xnormal/poly.im); 
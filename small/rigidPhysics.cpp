@@ -13,6 +13,13 @@
 #include "./include/phy/polygonrb.h"
 #include "./include/phy/linerb.h"
 #include "./include/phy/collision.h"
+#include "./include/phy/aabbtree.h"
+#include "./include/phy/manifoldcache.h"
+#include "./include/phy/contactsolver.h"
+#include "./include/phy/islands.h"
+#include "./include/phy/profiler.h"
+#include "./include/phy/headless.h"
+#include "./include/phy/perfhud.h"
 
 SDL_Renderer* renderer;
 constexpr int W = 680;
@@ -25,26 +32,13 @@ float w = 0.5;
 float angDispl = 0;
 float cr = 0.4;
 
-struct collisionInfo {
-	phy::vec2 vertex, intersection, edge, rp1, rp2;
-
-	phy::vec2 getDir() const {
-		return intersection - vertex;
-	}
-
-	void render(SDL_Renderer* renderer) const {
-		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-		SDL_RenderLine(renderer, vertex.x, vertex.y, intersection.x, intersection.y);
-	}
-
-	float length() const {
-		return getDir().length();
-	}
+// what a tree leaf points at: a polygon or a wall
+struct Collider {
+	phy::polygon* polygon = nullptr;
+	phy::LineRb* wall = nullptr;
 };
 
 float randRange(const float& min, const float& max);
-void checkWallBounce(phy::polygon& poly);
-bool checkPolygonCollision(phy::polygon& poly1, phy::polygon& poly2, collisionInfo& minCollision);
 phy::polygon makeBlock(const float& w, const float& h, const float& m, const float& im);
 void setupBlock(const float& w, const float& h, const float& angle, const float& x, const float& y);
 void setupCircle(const float& r, const float& angle, const float& x, const float& y);
@@ -54,105 +48,26 @@ void renderPolygon(phy::polygon& polygon);
 void drawFilledCircle(SDL_Renderer* r, float px, float py, float radius);
 bool pointInRect(const SDL_FPoint& point, const SDL_FRect& rect);
 bool rectToRectIntersect(const SDL_FRect& a, const SDL_FRect& b);
+phy::Rect2D getBounds(phy::polygon& polygon);
+phy::Rect2D getBounds(const phy::LineRb& wall);
 
 
 int selected = 0;
 phy::polygon* selectedPolygon = nullptr;
 std::vector<phy::polygon> polygons;
 std::vector<phy::LineRb> walls;
-std::vector<collisionInfo> collisionInfos;
-
-template<typename T>
-class Quadtree {
-
-    public:
-        SDL_FRect boundary;
-        int capacity = 4;
-        std::vector<T> objects;
-        bool isDivided = false;
-
-        std::vector<Quadtree> children;
-
-        Quadtree() = default;
-
-        Quadtree(const SDL_FRect& r, int maxObj = 4) {
-            boundary = r;
-            capacity = maxObj;
-        }
-
-        void insert(const T& object) {
-            if(!pointInRect(SDL_FPoint{ object->pos.x, object->pos.y }, boundary)) return;
-
-            if(objects.size() < capacity) {
-                objects.emplace_back(object);
-            } else {
-                if(!isDivided) {
-                    isDivided = true;
-                    const float wHalf = boundary.w / 2;
-                    const float hHalf = boundary.h / 2;
-                    children.push_back(Quadtree({ boundary.x, boundary.y, wHalf, hHalf }, capacity));
-                    children.push_back(Quadtree({ boundary.x + wHalf, boundary.y, wHalf, hHalf }, capacity));
-                    children.push_back(Quadtree({ boundary.x, boundary.y + hHalf, wHalf, hHalf }, capacity));
-                    children.push_back(Quadtree({ boundary.x + wHalf, boundary.y + hHalf, wHalf, hHalf }, capacity));
-
-                    for(auto it = objects.begin(); it != objects.end(); it++) {
-                        for(int i = 0; i < children.size(); i++) {
-                            auto& child = children[i];
-                            child.insert(*it);
-                        }
-                    }
-
-                    objects.clear();
-
-                }   // if !isDivided ends
-            }
-
-            if(isDivided) {
-                for(auto& child: children) {
-                    child.insert(object);
-                }
-            }
-
-        }
-
-        std::vector<T> findObject(const decltype(boundary)& range) {
-            if(!rectToRectIntersect(boundary, range)) return {};
-
-            std::vector<T> res;
-
-            if(!isDivided) {
-                for(auto& object: objects) {
-                    if(pointInRect({ object->pos.x, object->pos.y }, range)) res.emplace_back(object);
-                }
-                return res;
-            }
-
-            else {
-                for(auto& child: children) {
-                    auto pt = child.findObject(range);
-                    res.insert(res.begin(), pt.begin(), pt.end());
-                }
-            }
-
-            return res;
-        }
-
-        size_t size() const {
-            return objects.size();
-        }
-
-        void render(SDL_Renderer* renderer) {
-            SDL_RenderRect(renderer, &boundary);
-            for(auto& child: children) 
-                child.render(renderer);
-
-            for(auto& object: objects) {
-                drawFilledCircle(renderer, object->pos.x, object->pos.y, 1);
-            }
-        }
-};
 
-Quadtree<phy::polygon*> qtree;
+// polygons and walls share one tree; walls are static leaves
+phy::AABBTree<Collider> bvh;
+std::vector<Collider> colliders;
+std::vector<phy::AABBTree<Collider>::index_type> proxies;     // proxies[i] is the leaf of polygons[i]
+
+// bodies[i] mirrors colliders[i] for the solver; walls are static
+std::vector<phy::solverBody> bodies;
+phy::ManifoldCache manifolds;
+phy::ContactSolver solver;
+phy::Islands islands;        // same indices as colliders
+phy::PerfHud hud;
 
 
 
@@ -190,60 +105,27 @@ void init()
 	walls.push_back({ {W-1, 0.0f}, {W-1, FLOOR} });
 	walls.push_back({ {W - 100, 200.0f}, {200, 350} });
 
-    t0 = std::chrono::high_resolution_clock::now().time_since_epoch();
-}
-
-
-bool checkPolygonCollision(phy::polygon& poly1, phy::polygon& poly2, collisionInfo& minCollision) {
-	phy::polygon* polygon1 = &poly1;
-	phy::polygon* polygon2 = &poly2;
+	colliders.clear();
+	for(auto& polygon: polygons) colliders.push_back({ &polygon, nullptr });
+	for(auto& wall: walls) colliders.push_back({ nullptr, &wall });
 
-	float minLength = INFINITY;
-	bool isFirstPolyCollided = true;
-	bool hasCollided = false;
+	solver.getSettings().restitution = cr;
+	manifolds.clear();
+	islands.resize(colliders.size());
+	for(int i = 0; i < walls.size(); i++) islands.setStatic(polygons.size() + i, true);
 
-	for(int iter = 0; iter < 2; iter++) {
-		if(iter > 0) {
-			polygon1 = &poly2;
-			polygon2 = &poly1;
-		}
-
-		for(int i = 0; i < polygon1->vertices.size(); i++) {
-			auto l1 = polygon1->pos;
-			auto l2 = l1 + polygon1->vertices[i].rotate(polygon1->getRotation());
-
-			for(int j = 0; j < polygon2->vertices.size(); j++) {
-				auto l3 = polygon2->pos + polygon2->vertices[j].rotate(polygon2->getRotation());
-				auto l4 = polygon2->pos + polygon2->vertices[(j+1)%polygon2->vertices.size()].rotate(polygon2->getRotation());
-
-				float denom = (l1.x - l2.x) * (l3.y - l4.y) - (l1.y - l2.y) * (l3.x - l4.x);
-				float t = ((l1.x - l3.x) * (l3.y - l4.y) - (l1.y - l3.y) * (l3.x - l4.x)) / denom;
-				float u = -((l1.x - l2.x) * (l1.y - l3.y) - (l1.y - l2.y) * (l1.x - l3.x)) / denom;
-
-				if(t >= 0 && t <= 1 && u >= 0 && u <= 1) {
-					collisionInfo info;
-					info.vertex = l2;
-					info.intersection.x = l1.x + t * (l2.x - l1.x);
-					info.intersection.y = l1.y + t * (l2.y - l1.y);
-					info.edge = (l4 - l3).normalize();
-					info.rp1 = info.intersection - poly1.pos;
-					info.rp2 = info.intersection - poly2.pos;
-					
-					if(info.length() < minLength) {
-						minCollision = info;
-						hasCollided = true;
-						if(iter > 0) isFirstPolyCollided = false;
-					}
-				}
-			}
+	bvh.clear();
+	bvh.setMargin(4.0f);
+	proxies.clear();
+	for(int i = 0; i < polygons.size(); i++)
+		proxies.push_back(bvh.insert(&colliders[i], getBounds(polygons[i])));
+	for(int i = 0; i < walls.size(); i++)
+		bvh.insert(&colliders[polygons.size() + i], getBounds(walls[i]), true);
 
-		}
-
-	}
-
-	return hasCollided;
+    t0 = std::chrono::high_resolution_clock::now().time_since_epoch();
 }
 
+
 void render(SDL_Renderer* renderer)
 {
 	SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
@@ -258,7 +140,13 @@ void render(SDL_Renderer* renderer)
 		renderPolygon(polygon);
 	}
 
-	for(auto& info: collisionInfos) info.render(renderer);
+	SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
+	manifolds.forEach([&](auto, auto, const phy::manifold& m) {
+		for(int i = 0; i < m.count; i++) {
+			const auto& p = m.points[i].point;
+			SDL_RenderLine(renderer, p.x, p.y, p.x + m.normal.x * 5, p.y + m.normal.y * 5);
+		}
+	});
 
 	// qtree stuffs
 	// SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
@@ -281,71 +169,101 @@ void render(SDL_Renderer* renderer)
 void update(float dt, SDL_Renderer* renderer)
 {
 	selectedPolygon = &(polygons[selected % polygons.size()]);
-	// collisionInfos.clear();
 
-	// std::cout << dt << std::endl;
+	// sleeping islands are skipped until something awake touches them
+	{
+		PHY_ZONE("forces");
+		for(int i = 0; i < polygons.size(); i++) {
+			auto& polygon = polygons[i];
+			if(!islands.isAwake(i)) continue;
+			const float g = 5;
+			phy::vec2 weight{ 0, polygon.mass * g };
+			phy::vec2 drag = polygon.vel * -0.9;
+			polygon.force = weight + drag;
+			polygon.torque = 0;
+			polygon.torque += -1 * polygon.angVelo;
+
+			polygon.acc = polygon.force * (1/polygon.mass);
+			const float alph = polygon.torque / polygon.im;
+
+			polygon.vel += polygon.acc * dt;
+			polygon.angVelo += alph * dt;
+		}
+	}
 
-	qtree = Quadtree<phy::polygon*>({ 0, 0, W, H }, 4);
-    for(auto& polygon: polygons) qtree.insert(&polygon);
-	
-	for(auto& polygon: polygons) {
-		auto ranged = qtree.findObject({ polygon.pos.x - 50, polygon.pos.y - 50, 100, 100 });
-		// auto ranged = qtree.findObject({ 0, 0, W, H });
-		checkWallBounce(polygon);
-
-		// collision detection
-		// for(int i = 0; i < 5; i++)
-		for(auto& polygon2: ranged) {
-			if(&polygon != polygon2) {
-				collisionInfo info;
-				if(checkPolygonCollision(polygon, *polygon2, info)) {
-					auto displ = info.intersection - info.vertex;
-					polygon.pos -= displ * 0.5;
-					polygon2->pos += displ * 0.5;
-					// checkWallBounce
-					checkWallBounce(polygon);
-
-					//collision resolution
-					auto normal = info.edge.normalize().perp(1); //norm2.para(1);
-					auto rp1 = info.rp1; //polygon.vertices[i].rotate(obj1.rotation);
-					auto rp2 = info.rp2; //obj1.pos2D.add(rp1).subtract(obj2.pos2D);
-					auto vp1 = polygon.vel + rp1.perp(-polygon.angVelo*rp1.length());
-					auto vp2 = polygon2->vel + rp2.perp(-polygon2->angVelo*rp2.length());
-					auto vr = vp1 - vp2;
-					auto invm1 = 1/polygon.mass;
-					auto invm2 = 1/polygon2->mass;
-					auto invI1 = 1/polygon.im;
-					auto invI2 = 1/polygon2->im;
-					auto rp1Xn = rp1.crossProduct(normal);
-					auto rp2Xn = rp1.crossProduct(normal);						
-					auto impulse = -(1+cr)*vr.dotProduct(normal)/(invm1 + invm2 + rp1Xn*rp1Xn*invI1 + rp2Xn*rp2Xn*invI2); 
-					polygon.vel = polygon.vel + normal * (impulse*invm1);
-					polygon.angVelo += rp1.crossProduct(normal)*impulse*invI1;
-					polygon2->vel = polygon2->vel - normal * (impulse*invm2);
-					polygon2->angVelo += -rp2.crossProduct(normal) * impulse * invI2;
-				}
-			}
-		}	// collision detection ends
+	// only polygons that left their fat box get reinserted. A sleeping polygon rests as a
+	// static leaf that awake ones still find; the flags are synced before the pairs, so a
+	// polygon woken since the last step already pairs with walls and sleepers this step
+	{
+		PHY_ZONE("broadphase");
+		for(int i = 0; i < polygons.size(); i++) {
+			const bool awake = islands.isAwake(i);
+			bvh.setStatic(proxies[i], !awake);
+			if(awake) bvh.move(proxies[i], getBounds(polygons[i]), polygons[i].vel * dt);
+		}
+		bvh.updatePairs();
+	}
 
-		polygon.pos += polygon.vel * dt;
-		polygon.setRotation(polygon.angVelo * dt);
-		
-		checkWallBounce(polygon);
+	bodies.resize(colliders.size());
+	for(int i = 0; i < polygons.size(); i++) {
+		auto& polygon = polygons[i];
+		bodies[i] = { polygon.pos, polygon.vel, polygon.angVelo, 1/polygon.mass, 1/polygon.im };
+	}
+	for(int i = 0; i < walls.size(); i++)
+		bodies[polygons.size() + i] = { (walls[i].startPos + walls[i].endPos) * 0.5f, { 0, 0 }, 0, 0, 0 };
 
-		const float g = 5;
-		phy::vec2 weight{ 0, polygon.mass * g };
-		phy::vec2 drag = polygon.vel * -0.9;
-		polygon.force = weight + drag;
-		polygon.torque = 0;
-		polygon.torque += -1 * polygon.angVelo;
+	// collision detection; walls come after the polygons, so b is the wall if there is one
+	{
+		PHY_ZONE("narrowphase");
+		for(auto [a, b]: bvh.getPairs()) {
+			if(a > b) std::swap(a, b);
+			phy::manifold m;
+			bool touching;
+			if(b->wall) {
+				const phy::vec2 segment[] = { b->wall->startPos, b->wall->endPos };
+				touching = phy::collision::polygonManifold(a->polygon->getWorldVertices(), segment, m);
+			} else {
+				touching = phy::collision::polygonManifold(a->polygon->getWorldVertices(), b->polygon->getWorldVertices(), m);
+			}
 
-		polygon.acc = polygon.force * (1/polygon.mass);
-		const float alph = polygon.torque / polygon.im;
+			if(touching) {
+				const auto ia = static_cast<phy::ContactSolver::index_type>(a - colliders.data());
+				const auto ib = static_cast<phy::ContactSolver::index_type>(b - colliders.data());
+				islands.addContact(ia, ib);
+				solver.add(ia, ib, manifolds.update(ia, ib, m));
+			}
+		}
+		manifolds.prune();
+	}
 
-		polygon.vel += polygon.acc * dt;
-		polygon.angVelo += alph * dt;
+	// collision resolution, all contacts at once
+	{
+		PHY_ZONE("solve");
+		solver.solve(bodies, dt);
 	}
 
+	{
+		PHY_ZONE("integrate");
+		for(int i = 0; i < polygons.size(); i++) {
+			auto& polygon = polygons[i];
+			if(!islands.isAwake(i)) continue;
+			polygon.vel = bodies[i].vel;
+			polygon.angVelo = bodies[i].angVelo;
+			polygon.pos += polygon.vel * dt;
+			polygon.rotate(polygon.angVelo * dt);
+		}
+	}
+
+	PHY_ZONE("islands");
+	islands.update(dt, [](const auto& i) {
+		return polygons[i].vel.length() < 1.0f && std::abs(polygons[i].angVelo) < 0.05f;
+	});
+
+	for(int i = 0; i < polygons.size(); i++) {
+		if(islands.isAwake(i)) continue;
+		polygons[i].vel = { 0, 0 };
+		polygons[i].angVelo = 0;
+	}
 }
 
 bool processEvent(SDL_Event& evt) {
@@ -354,6 +272,7 @@ bool processEvent(SDL_Event& evt) {
 			return true;
 		case SDL_EVENT_KEY_DOWN:
 			// if(!selectedPolygon) break;
+			islands.wake(selectedPolygon - polygons.data());
 			switch(evt.key.key) {
 				case SDLK_W:
 					selectedPolygon->pos.y--;
@@ -373,6 +292,9 @@ bool processEvent(SDL_Event& evt) {
 				case SDLK_RIGHT:
 					selected++;
 					break;
+				case SDLK_H:
+					hud.visible = !hud.visible;
+					break;
 
 			}
 	}
@@ -380,8 +302,14 @@ bool processEvent(SDL_Event& evt) {
 }
 
 
-int main()
+int main(int argc, char** argv)
 {
+	// --headless [ticks] steps the world without opening a window
+	if(const int ticks = phy::headlessTicks(argc, argv)) {
+		init();
+		return phy::runHeadless("rigidPhysics", ticks, 1.0f / 60, [](const float& dt) { update(dt, nullptr); });
+	}
+
 	if (SDL_Init(SDL_INIT_VIDEO) <= 0)
 	{
 		SDL_Log("SDL_INITIALIZATION ERROR: %s", SDL_GetError());
@@ -407,18 +335,30 @@ int main()
 	init();
 	while (!windowShouldClose)
 	{
+		PHY_ZONE("frame");
 		while (SDL_PollEvent(&evt))
 			windowShouldClose = processEvent(evt);
         const auto now = std::chrono::high_resolution_clock::now().time_since_epoch();
         const float dt = (now - t0).count() * 10e-9;
         t0 = now;
+		const auto physicsStart = std::chrono::steady_clock::now();
 		update(dt, renderer);
-		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-		SDL_RenderClear(renderer);
-		render(renderer);
+		hud.setPhysicsTime(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - physicsStart).count());
+		hud.setCounter("BODIES", polygons.size());
+		hud.setCounter("PAIRS", bvh.getPairs().size());
+		hud.setCounter("CONTACTS", manifolds.size());
+		hud.setCounter("TREE NODES", bvh.nodeCount());
+		{
+			PHY_ZONE("render");
+			SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+			SDL_RenderClear(renderer);
+			render(renderer);
+			hud.render(renderer);
+		}
 		SDL_RenderPresent(renderer);
 	}
 
+	if(phy::hasFlag(argc, argv, "--trace")) PHY_PROFILE_DUMP("rigidPhysics.trace.json");
 	SDL_DestroyWindow(window);
 	SDL_Quit();
 	return 0;
@@ -458,43 +398,16 @@ void drawFilledCircle(SDL_Renderer* r, float px, float py, float radius)
 
 void renderPolygon(phy::polygon &polygon)
 {
-	for(int i = 0; i < polygon.vertices.size(); i++) {
-		auto v1 = polygon.pos + polygon.vertices[i].rotate(polygon.getRotation());
-		auto v2 = polygon.pos + polygon.vertices[(i+1)%polygon.vertices.size()].rotate(polygon.getRotation());
+	const auto& world = polygon.getWorldVertices();
+	for(int i = 0; i < world.size(); i++) {
+		auto& v1 = world[i];
+		auto& v2 = world[(i+1)%world.size()];
 		SDL_RenderLine(renderer, v1.x, v1.y, v2.x, v2.y);
 	}
-	auto end = polygon.pos + polygon.vertices[0].rotate(polygon.getRotation());
+	auto& end = world[0];
 	SDL_RenderLine(renderer, polygon.pos.x, polygon.pos.y, end.x, end.y);
 }
 
-void checkWallBounce(phy::polygon& poly) {
-	for(auto& wall: walls) {
-
-		for(int i = 0; i < poly.vertices.size(); i++) {
-			auto l1 = poly.pos;
-			auto l2 = poly.pos + poly.vertices[i].rotate(poly.getRotation());
-			phy::collisionInfo info;
-			if(phy::collision::lineToLineIntersect(l1, l2, wall.startPos, wall.endPos, info)) {
-				auto normal = info.normal;
-				if(normal.dotProduct(poly.vel) > 0) {
-					normal *= -1;
-				}
-				float dist = info.getDir().dotProduct(normal);
-				poly.pos += normal * dist;
-
-				// const float cr = 0;
-				auto rp1 = poly.vertices[i].rotate(poly.getRotation());
-				auto vp1 = poly.vel + rp1.perp(-poly.angVelo*rp1.length());
-				auto rp1Xnormal = rp1.crossProduct(normal);
-				auto impulse = -(1+cr)*vp1.dotProduct(normal)/(1/poly.mass + rp1Xnormal*rp1Xnormal/poly.im); 
-				poly.vel = poly.vel + normal * (impulse/poly.mass);
-				poly.angVelo += rp1.crossProduct(normal)*impulse/poly.im;
-			}
-		}
-
-	}
-}
-
 phy::polygon makeBlock(const float& w, const float& h, const float& m, const float& im){
 	std::vector<phy::vec2> vertices {
 		{-w/2,-h/2},
@@ -567,6 +480,23 @@ bool rectToRectIntersect(const SDL_FRect &a, const SDL_FRect &b)
     return (a.x < b.x + b.w && a.x + a.w > b.x && a.y < b.y + b.h && a.y + a.h > b.y);
 }
 
+phy::Rect2D getBounds(phy::polygon& polygon)
+{
+	phy::vec2 min{ INFINITY, INFINITY }, max{ -INFINITY, -INFINITY };
+	for(auto& v: polygon.getWorldVertices()) {
+		min = { std::min(min.x, v.x), std::min(min.y, v.y) };
+		max = { std::max(max.x, v.x), std::max(max.y, v.y) };
+	}
+	return phy::Rect2D{ min, max - min };
+}
+
+phy::Rect2D getBounds(const phy::LineRb& wall)
+{
+	phy::vec2 min{ std::min(wall.startPos.x, wall.endPos.x), std::min(wall.startPos.y, wall.endPos.y) };
+	phy::vec2 max{ std::max(wall.startPos.x, wall.endPos.x), std::max(wall.startPos.y, wall.endPos.y) };
+	return phy::Rect2D{ min, max - min };
+}
+
 float randRange(const float& min, const float& max)
 {
     std::random_device rd;
@@ -9,6 +9,8 @@ TODO: once ball rect has intersect with a static ball, just ignore other collisi
 #include <SDL3/SDL.h>
 
 #include "./include/phy/vec2.h"
+#include "./include/phy/threadpool.h"
+#include "./include/phy/constraintgraph.h"
 
 constexpr int W = 640;
 constexpr int H = 480;
@@ -47,6 +49,9 @@ int ropeLength;
 phy::vec2 pivot1, pivot2;
 std::vector<Particle> particles;
 std::vector<std::vector<Particle*>> constraints;
+std::vector<phy::ConstraintGraph::edge_type> springs;   // every (particle, neighbour) of constraints
+phy::ConstraintGraph graph;
+phy::ThreadPool pool;
 
 phy::vec2 makeSpringForce(const phy::vec2& a, phy::vec2& b, const float& k)
 {
@@ -74,29 +79,24 @@ void calcAcceleration()
 }
 
 
+// springs of one color share no particle, so each color runs across the pool
 void solveConstraint() {
-    for(int i = 0; i < particles.size(); i++)
-    {
-        auto& particle = particles[i];
-        auto& constraint = constraints[i];
-
-        for(int j = 0; j < constraint.size(); j++)
-        {
-            auto& pConst = constraint[j];
-            auto delta = pConst->pos - particle.pos;
-            float dist = delta.length();
-            if(dist == 0.0f) continue;
-            auto normal = delta * (1 / dist);
-            float diff = (dist - ropeLength) * (0.5f * k);
-
-            float wA = 1 / particle.mass;
-            float wB = 1 / pConst->mass;
-            float sum = wA + wB;
-
-            particle.pos += normal * diff * (wA / sum);
-            pConst->pos -= normal * diff * (wB / sum);
-        }
-    }
+    graph.solve([](const auto& c) {
+        auto& particle = particles[springs[c].first];
+        auto& pConst = particles[springs[c].second];
+        auto delta = pConst.pos - particle.pos;
+        float dist = delta.length();
+        if(dist == 0.0f) return;
+        auto normal = delta * (1 / dist);
+        float diff = (dist - ropeLength) * (0.5f * k);
+
+        float wA = 1 / particle.mass;
+        float wB = 1 / pConst.mass;
+        float sum = wA + wB;
+
+        particle.pos += normal * diff * (wA / sum);
+        pConst.pos -= normal * diff * (wB / sum);
+    }, &pool);
 }
 
 void physicsProcess(const float& dt)
@@ -180,6 +180,12 @@ bool init()
     }
     constraints.push_back({});  // for back
 
+    springs.clear();
+    for(int i = 0; i < constraints.size(); i++)
+        for(auto& particle2: constraints[i])
+            springs.push_back({ static_cast<phy::ConstraintGraph::index_type>(i), static_cast<phy::ConstraintGraph::index_type>(particle2 - particles.data()) });
+    graph.build(springs, particles.size());
+
 	return true;
 }
 
@@ -1,13 +1,18 @@
 #include <iostream>
-#include <memory>
 #include <random>
 #include <string>
 #include <vector>
+#include <cmath>
 #include <chrono>
-#include <variant>
 #include <SDL3/SDL.h>
 
 #include "./include/phy/vec2.h"
+#include "./include/phy/threadpool.h"
+#include "./include/phy/constraintgraph.h"
+#include "./include/phy/xpbd.h"
+#include "./include/phy/particlestore.h"
+#include "./include/phy/profiler.h"
+#include "./include/phy/headless.h"
 
 constexpr int W = 640;
 constexpr int H = 480;
@@ -37,65 +42,102 @@ struct AABB
 	phy::vec2 pos, size;
 };
 
-enum class BodyType
+// PBD projects sticks 5 times a step, so stiffness hangs on the iteration count;
+// XPBD substeps with a compliance per constraint
+enum class SolverMode
 {
-	DEFAULT,
-	PARTICLE
-};
-
-
-struct PhysicsObject
-{
-	phy::vec2 pos, lastPos, acc;
-	float radius = 1.0f;
-	float mass = 1.0f;
-	virtual ~PhysicsObject() = default;
-};
-
-struct Particle: PhysicsObject
-{
-
+	PBD,
+	XPBD
 };
 
 
 struct Stick
 {
-	PhysicsObject *vertA, *vertB;
+	phy::ParticleStore::index_type a, b;
 	float length;
 };
 
 
 class PhysicsWorld
 {
-	using body_type = std::unique_ptr<PhysicsObject>;
+	using index_type = phy::ParticleStore::index_type;
 
-	std::vector<std::unique_ptr<PhysicsObject>> vertices;
+	phy::ParticleStore particles;
 	std::vector<Stick> sticks;
+	std::vector<phy::ConstraintGraph::edge_type> stickEnds;	// stickEnds[i] are the particle indices of sticks[i]
+	phy::ConstraintGraph graph;
+	phy::ThreadPool pool;
+	bool graphDirty = false;
+
+	SolverMode mode = SolverMode::XPBD;
+	int substeps = 10;
+	phy::XPBDSolver xpbd;
 
 	public:
 
-	template<typename T, typename... Args>
-	T& createObject(Args&&... args) {
-		static_assert(std::is_base_of_v<PhysicsObject, T>);
-		auto vertex = std::make_unique<T>(std::forward<Args>(args)...);
-		T& ref = *vertex;
-		vertices.push_back(std::move(vertex));
-		return ref;
+	index_type createParticle(const float& px, const float& py, const float& r = 3.0f, const float& mass = 1.0f) {
+		return particles.add(phy::vec2{ px, py }, r, mass);
+	}
+
+	phy::ParticleStore& getParticles() {
+		return particles;
+	}
+
+	// compliance only matters in XPBD mode; 0 is a rigid stick
+	void addStick(const index_type& a, const index_type& b, const float& length, const float& compliance = 0.0f)
+	{
+		xpbd.addDistance(a, b, length, compliance);
+		sticks.push_back({ a, b, length });
+		stickEnds.push_back({ a, b });
+		graphDirty = true;
 	}
 
-	void addStick(const int& a, const int& b, const float& length)
+	// keeps the area inside the loop of particles at its current value
+	void addArea(const std::vector<phy::XPBDSolver::index_type>& loop, const float& compliance = 0.0f)
 	{
-		sticks.push_back({ &(*vertices[a]), &(*vertices[b]), length });
+		xpbd.addArea(loop, phy::XPBDSolver::area(particles.x, particles.y, loop), compliance);
+	}
+
+	void setSolverMode(const SolverMode& m) {
+		mode = m;
+	}
+
+	SolverMode getSolverMode() const {
+		return mode;
 	}
 
 	void update(const float& dt) 
 	{
-		calcAcceleration();
-		integratePosition(dt);
-		
-		for(int i = 0; i < 5; i++) {
-			solveConstraints();
-			solveBoundaryConstraint();
+		if(mode == SolverMode::PBD) {
+			{
+				PHY_ZONE("integrate");
+				particles.integrate(dt, phy::vec2{ 0, g }, damping);
+			}
+
+			for(int i = 0; i < 5; i++) {
+				{
+					PHY_ZONE("solve");
+					solveConstraints();
+				}
+				PHY_ZONE("boundary");
+				solveBoundaryConstraint(damping);
+			}
+			return;
+		}
+
+		const float h = dt / substeps;
+		const float substepDamping = std::pow(damping, 1.0f / substeps);
+		for(int i = 0; i < substeps; i++) {
+			{
+				PHY_ZONE("integrate");
+				particles.integrate(h, phy::vec2{ 0, g }, substepDamping);
+			}
+			{
+				PHY_ZONE("solve");
+				xpbd.solve(particles.x, particles.y, particles.invMass, h, &pool);
+			}
+			PHY_ZONE("boundary");
+			solveBoundaryConstraint(substepDamping);
 		}
 	}
 
@@ -114,21 +156,18 @@ class PhysicsWorld
 		SDL_RenderRect(renderer, &rect);
 
 		SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
-		for(auto& vertex: vertices)
-			drawFilledCircle(renderer, vertex->pos.x, vertex->pos.y, vertex->radius);
+		for(size_t i = 0; i < particles.size(); i++)
+			drawFilledCircle(renderer, particles.x[i], particles.y[i], particles.radius[i]);
 
 		SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-		for(auto& stick: sticks) {
-			auto& v1 = stick.vertA->pos;
-			auto& v2 = stick.vertB->pos;
-			SDL_RenderLine(renderer, v1.x, v1.y, v2.x, v2.y);
-		}
+		for(auto& stick: sticks)
+			SDL_RenderLine(renderer, particles.x[stick.a], particles.y[stick.a], particles.x[stick.b], particles.y[stick.b]);
 
 	}
 
 
 	size_t size() {
-		return vertices.size();
+		return particles.size();
 	}
 
 
@@ -138,63 +177,36 @@ class PhysicsWorld
 		float damping = 0.98f;
 		float groundFriction = 0.85f;
 
-		void solveBoundaryConstraint() {
-			for(auto& vertex: vertices)
-			{
-				auto vel = (vertex->pos - vertex->lastPos) * damping;
-				if(vertex->pos.y + vertex->radius > boundary.pos.y + boundary.size.y)
-				{
-					vertex->pos.y = boundary.pos.y + boundary.size.y - vertex->radius;
-					vertex->lastPos.y = vertex->pos.y + vel.y * groundFriction;
-				}
-
-				if(vertex->pos.x - vertex->radius < 0)
-				{
-					vertex->pos.x = vertex->radius;
-					vertex->lastPos.x = vertex->pos.x + vel.x * groundFriction;
-				} else if(vertex->pos.x + vertex->radius > boundary.pos.x + boundary.size.x) {
-					vertex->pos.x = boundary.pos.x + boundary.size.x - vertex->radius;
-					vertex->lastPos.x = vertex->pos.x + vel.x * groundFriction;
-				}
-			}
+		// stepDamping matches the step it follows: the frame's for PBD, the substep's for XPBD
+		void solveBoundaryConstraint(const float& stepDamping) {
+			particles.constrainToBox(boundary.pos.x, boundary.pos.x + boundary.size.x, boundary.pos.y + boundary.size.y, stepDamping, groundFriction);
 		}
 
+		// sticks of one color share no particle, so each color runs across the pool
 		void solveConstraints()
 		{
-			for(auto& stick: sticks)
-			{
-				auto delta = stick.vertB->pos - stick.vertA->pos;
-				float dist = delta.length();
-				if(dist == 0.0f) continue;
-				auto normal = delta * (1 / dist);
-				float diff = (dist - stick.length) * 0.5f;
-
-				float wA = 1 / stick.vertA->mass;
-				float wB = 1 / stick.vertB->mass;
-				float sum = wA + wB;
-
-				stick.vertA->pos += normal * diff * (wA / sum);
-				stick.vertB->pos -= normal * diff * (wB / sum);
-			}
-		}
-
-		void integratePosition(const float& dt) 
-		{
-			for(auto& vertex: vertices) {
-				auto tmp = vertex->pos;
-				auto vel = (vertex->pos - vertex->lastPos) * damping;
-				vertex->pos += vel + vertex->acc * (dt * dt);
-				vertex->acc = phy::vec2{ 0, 0 };
-				vertex->lastPos = tmp;
+			if(graphDirty) {
+				graph.build(stickEnds, particles.size());
+				graphDirty = false;
 			}
-		}
 
-		void calcAcceleration() {
-			for(auto& vertex: vertices) {
-				phy::vec2 weight { 0, vertex->mass * g };
-				auto force = weight;
-				vertex->acc += force * (1 / vertex->mass);
-			}
+			auto& x = particles.x;
+			auto& y = particles.y;
+			auto& invMass = particles.invMass;
+			graph.solve([&](const auto& i) {
+				auto& stick = sticks[i];
+				const float dx = x[stick.b] - x[stick.a], dy = y[stick.b] - y[stick.a];
+				const float dist = std::sqrt(dx * dx + dy * dy);
+				const float wA = invMass[stick.a], wB = invMass[stick.b];
+				const float sum = wA + wB;
+				if(dist == 0.0f || sum == 0.0f) return;
+				const float diff = (dist - stick.length) * 0.5f / dist;
+
+				x[stick.a] += dx * diff * (wA / sum);
+				y[stick.a] += dy * diff * (wA / sum);
+				x[stick.b] -= dx * diff * (wB / sum);
+				y[stick.b] -= dy * diff * (wB / sum);
+			}, &pool);
 		}
 
 } world;
@@ -216,26 +228,17 @@ bool init()
 {
 	world.setBoundary(0.0f, 0.0f, W, H);
 
-	auto createParticle = [](const float& px, const float& py, const float& r = 3.0f) -> Particle& {
-		auto& p = world.createObject<Particle>();
-		p.pos = phy::vec2{ px, py };
-		p.lastPos = p.pos;
-		p.radius = r;
-
-		return p;
-	};
-
 	for(int i = 0; i < 1; i++)
 	{
 
-		createParticle(randRange(30, W - 50), randRange(0, 1), 20);
+		world.createParticle(randRange(30, W - 50), randRange(0, 1), 20);
 	}
 
-	auto& a = createParticle(100, 0);
-	a.lastPos.y = -5.0f;
-	createParticle(150, 0);
-	createParticle(150, 50);
-	createParticle(100, 50);
+	auto a = world.createParticle(100, 0);
+	world.getParticles().prevY[a] = -5.0f;
+	world.createParticle(150, 0);
+	world.createParticle(150, 50);
+	world.createParticle(100, 50);
 
 	world.addStick(1, 2, 50);
 	world.addStick(2, 3, 50);
@@ -243,13 +246,20 @@ bool init()
 	world.addStick(4, 1, 50);
 	world.addStick(1, 3, std::hypot(50, 50));
 	world.addStick(2, 4, std::hypot(50, 50));
+	world.addArea({ 1, 2, 3, 4 });
 
 	return true;
 }
 
 
-int main()
+int main(int argc, char** argv)
 {
+	// --headless [ticks] steps the world without opening a window
+	if(const int ticks = phy::headlessTicks(argc, argv)) {
+		init();
+		return phy::runHeadless("verlet", ticks, fixedTimeStep, [](const float& dt) { world.update(dt); });
+	}
+
 	canvas.window = SDL_CreateWindow("Verlet Integration", W, H, 0);
 	canvas.renderer = SDL_CreateRenderer(canvas.window, nullptr);
 
@@ -262,6 +272,7 @@ int main()
 	init();
 
 	animate();
+	if(phy::hasFlag(argc, argv, "--trace")) PHY_PROFILE_DUMP("verlet.trace.json");
 	SDL_DestroyWindow(canvas.window);
 	SDL_Quit();
 	return 0;
@@ -278,6 +289,12 @@ void pollEvent(SDL_Event& evt)
 			return;
 		}
 
+		// X switches between the PBD and XPBD solvers
+		if(evt.type == SDL_EVENT_KEY_DOWN && evt.key.key == SDLK_X)
+		{
+			world.setSolverMode(world.getSolverMode() == SolverMode::PBD ? SolverMode::XPBD : SolverMode::PBD);
+		}
+
 		if(evt.type == SDL_EVENT_MOUSE_BUTTON_DOWN)
 		{
 		
@@ -299,6 +316,7 @@ void animate()
 	t0 = std::chrono::high_resolution_clock::now().time_since_epoch();
 	while (!canvas.windowShouldClose)
 	{
+		PHY_ZONE("frame");
 		auto t1 = std::chrono::high_resolution_clock::now().time_since_epoch();
 		const float dt = (t1 - t0).count() * 10e-9;
 		t0 = t1;
@@ -311,9 +329,12 @@ void animate()
 			fixedTimeAccumulator -= fixedTimeStep;
 		}
 
-		SDL_SetRenderDrawColor(canvas.renderer, 0, 0, 0, 255);
-		SDL_RenderClear(canvas.renderer);
-		render(canvas.renderer);
+		{
+			PHY_ZONE("render");
+			SDL_SetRenderDrawColor(canvas.renderer, 0, 0, 0, 255);
+			SDL_RenderClear(canvas.renderer);
+			render(canvas.renderer);
+		}
 		SDL_RenderPresent(canvas.renderer);
 	}
 }
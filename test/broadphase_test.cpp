@@ -0,0 +1,290 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "../small/include/phy/spatialhash.h"
+#include "../small/include/phy/sweepandprune.h"
+#include "../small/include/phy/aabbtree.h"
+#include "../small/include/phy/islands.h"
+
+
+static std::vector<phy::Rect2D> makeRects(const int& count, const float& w, const float& h, const float& minSize, const float& maxSize, const unsigned& seed = 5)
+{
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<float> px(0.0f, w - maxSize), py(0.0f, h - maxSize), sz(minSize, maxSize);
+
+	std::vector<phy::Rect2D> rects;
+	for(int i = 0; i < count; i++)
+		rects.push_back(phy::Rect2D{ { px(gen), py(gen) }, { sz(gen), sz(gen) } });
+	return rects;
+}
+
+static bool overlaps(const phy::Rect2D& a, const phy::Rect2D& b)
+{
+	return a.pos.x < b.pos.x + b.size.x && a.pos.x + a.size.x > b.pos.x &&
+		a.pos.y < b.pos.y + b.size.y && a.pos.y + a.size.y > b.pos.y;
+}
+
+using PairSet = std::set<std::pair<const phy::Rect2D*, const phy::Rect2D*>>;
+
+static std::pair<const phy::Rect2D*, const phy::Rect2D*> ordered(const phy::Rect2D* a, const phy::Rect2D* b)
+{
+	return a < b ? std::make_pair(a, b) : std::make_pair(b, a);
+}
+
+static PairSet bruteForcePairs(const std::vector<phy::Rect2D>& rects)
+{
+	PairSet pairs;
+	for(size_t i = 0; i < rects.size(); i++)
+		for(size_t j = i + 1; j < rects.size(); j++)
+			if(overlaps(rects[i], rects[j])) pairs.insert(ordered(&rects[i], &rects[j]));
+	return pairs;
+}
+
+
+TEST(SpatialHashGrid, PairsMatchBruteForceExactlyOnce)
+{
+	for(const float cellSize: { 20.0f, 40.0f, 8.0f }) {
+		auto rects = makeRects(1500, 480, 640, 10, 20);
+		phy::SpatialHashGrid<phy::Rect2D> grid;
+		grid.resize(phy::Rect2D{ { 0, 0 }, { 480, 640 } }, cellSize);
+		for(auto& r: rects) grid.insert(&r);
+		grid.build();
+
+		std::vector<phy::SpatialHashGrid<phy::Rect2D>::Pair> pairs;
+		grid.getPairs(pairs);
+
+		PairSet found;
+		for(auto& [a, b]: pairs) EXPECT_TRUE(found.insert(ordered(a, b)).second) << "pair reported twice";
+		EXPECT_EQ(found, bruteForcePairs(rects)) << "cell size " << cellSize;
+	}
+}
+
+TEST(SpatialHashGrid, RangeMatchesBruteForce)
+{
+	auto rects = makeRects(2000, 1024, 640, 4, 30);
+	phy::SpatialHashGrid<phy::Rect2D> grid;
+	grid.resize(phy::Rect2D{ { 0, 0 }, { 1024, 640 } }, 32);
+	for(auto& r: rects) grid.insert(&r);
+	grid.build();
+
+	phy::Rect2D range{ { 300, 200 }, { 150, 90 } };
+	std::vector<phy::Rect2D*> queried, expected;
+	grid.getRange(range, queried);
+	for(auto& r: rects) if(overlaps(r, range)) expected.push_back(&r);
+
+	std::sort(queried.begin(), queried.end());
+	std::sort(expected.begin(), expected.end());
+	EXPECT_EQ(queried, expected);
+}
+
+TEST(SweepAndPrune, PairsTrackMovingBoxesAcrossFrames)
+{
+	auto rects = makeRects(800, 640, 480, 5, 25);
+	phy::SweepAndPrune<phy::Rect2D> sap;
+	std::vector<phy::SweepAndPrune<phy::Rect2D>::index_type> proxies;
+	for(auto& r: rects) proxies.push_back(sap.add(&r, r));
+
+	std::mt19937 gen(9);
+	std::uniform_real_distribution<float> step(-3.0f, 3.0f);
+	for(int frame = 0; frame < 30; frame++) {
+		for(size_t i = 0; i < rects.size(); i++) {
+			rects[i].pos.x += step(gen);
+			rects[i].pos.y += step(gen);
+			sap.move(proxies[i], rects[i]);
+		}
+		sap.update();
+
+		PairSet found;
+		for(auto& [a, b]: sap.getPairs()) ASSERT_TRUE(found.insert(ordered(a, b)).second);
+		ASSERT_EQ(found, bruteForcePairs(rects)) << "frame " << frame;
+	}
+}
+
+TEST(SweepAndPrune, StaticProxiesDoNotPairWithEachOther)
+{
+	phy::Rect2D wallA{ { 0, 0 }, { 100, 10 } }, wallB{ { 50, 5 }, { 100, 10 } }, box{ { 60, 0 }, { 10, 10 } };
+	phy::SweepAndPrune<phy::Rect2D> sap;
+	sap.add(&wallA, wallA, true);
+	sap.add(&wallB, wallB, true);
+	const auto id = sap.add(&box, box);
+	sap.update();
+	EXPECT_EQ(sap.getPairs().size(), 2u);
+
+	sap.remove(id);
+	sap.update();
+	EXPECT_TRUE(sap.getPairs().empty());
+}
+
+// the eightball step: proxies of sleeping bodies are static, synced from the islands
+// right before the sweep
+TEST(SweepAndPrune, WokenBodyPairsWithSleeperOnFirstStep)
+{
+	std::vector<phy::Rect2D> boxes{ phy::Rect2D{ { 0, 0 }, { 10, 10 } }, phy::Rect2D{ { 8, 0 }, { 10, 10 } }, phy::Rect2D{ { 0, 8 }, { 40, 4 } } };
+	phy::SweepAndPrune<phy::Rect2D> sap;
+	phy::Islands islands;
+	islands.resize(boxes.size());
+	islands.setStatic(2, true);
+	std::vector<phy::SweepAndPrune<phy::Rect2D>::index_type> proxies;
+	for(size_t i = 0; i < boxes.size(); i++) proxies.push_back(sap.add(&boxes[i], boxes[i], i == 2));
+
+	auto sweep = [&]() {
+		for(phy::Islands::index_type i = 0; i < 2; i++) sap.setStatic(proxies[i], !islands.isAwake(i));
+		sap.update();
+	};
+	for(int i = 0; i < 10; i++) {
+		sweep();
+		islands.update(0.1f, [](const auto&) { return true; });
+	}
+	ASSERT_FALSE(islands.isAwake(0));
+	ASSERT_FALSE(islands.isAwake(1));
+	sweep();
+	EXPECT_TRUE(sap.getPairs().empty());
+
+	// 0 is woken alone; 1 still sleeps, so 1 and the floor stay unpaired
+	islands.wake(0);
+	sweep();
+	PairSet found;
+	for(auto& [a, b]: sap.getPairs()) found.insert(ordered(a, b));
+	EXPECT_EQ(found, (PairSet{ ordered(&boxes[0], &boxes[1]), ordered(&boxes[0], &boxes[2]) }));
+}
+
+TEST(AABBTree, PairsCoverBruteForceWhileMoving)
+{
+	// small bodies plus a few long thin walls, the case a uniform grid handles badly
+	auto rects = makeRects(600, 640, 480, 2, 30);
+	std::vector<phy::Rect2D> walls = {
+		phy::Rect2D{ { 0, 0 }, { 640, 4 } }, phy::Rect2D{ { 0, 476 }, { 640, 4 } },
+		phy::Rect2D{ { 0, 0 }, { 4, 480 } }, phy::Rect2D{ { 120, 200 }, { 400, 3 } }
+	};
+
+	phy::AABBTree<phy::Rect2D> tree;
+	std::vector<phy::AABBTree<phy::Rect2D>::index_type> proxies;
+	for(auto& w: walls) tree.insert(&w, w, true);
+	for(auto& r: rects) proxies.push_back(tree.insert(&r, r));
+	EXPECT_LE(tree.getHeight(), 2 * int(std::log2(tree.size())) + 2);
+
+	std::mt19937 gen(3);
+	std::uniform_real_distribution<float> step(-4.0f, 4.0f);
+	for(int frame = 0; frame < 30; frame++) {
+		for(size_t i = 0; i < rects.size(); i++) {
+			const phy::vec2 d{ step(gen), step(gen) };
+			rects[i].pos += d;
+			tree.move(proxies[i], rects[i], d);
+		}
+		tree.updatePairs();
+
+		PairSet found;
+		for(auto& [a, b]: tree.getPairs()) ASSERT_TRUE(found.insert(ordered(a, b)).second) << "pair reported twice";
+
+		// fat boxes make the pairs a superset of the exact overlaps
+		for(auto& pair: bruteForcePairs(rects)) ASSERT_TRUE(found.count(pair)) << "frame " << frame;
+		for(auto& w: walls) {
+			for(auto& r: rects) {
+				if(overlaps(w, r)) { ASSERT_TRUE(found.count(ordered(&w, &r))); }
+			}
+		}
+		for(auto& [a, b]: found)
+			ASSERT_FALSE(a >= &walls.front() && a <= &walls.back() && b >= &walls.front() && b <= &walls.back());
+	}
+}
+
+// the rigidPhysics step: sleeping polygons are static leaves, synced from the islands
+// right before updatePairs()
+TEST(AABBTree, WokenBodyPairsWithWallOnFirstStep)
+{
+	std::vector<phy::Rect2D> boxes{ phy::Rect2D{ { 0, 0 }, { 10, 10 } }, phy::Rect2D{ { 12, 0 }, { 10, 10 } } };
+	phy::Rect2D wall{ { -20, 10 }, { 60, 4 } };
+	phy::AABBTree<phy::Rect2D> tree;
+	phy::Islands islands;
+	islands.resize(boxes.size());
+	std::vector<phy::AABBTree<phy::Rect2D>::index_type> proxies;
+	for(auto& b: boxes) proxies.push_back(tree.insert(&b, b));
+	tree.insert(&wall, wall, true);
+
+	auto sweep = [&]() {
+		for(phy::Islands::index_type i = 0; i < boxes.size(); i++) {
+			const bool awake = islands.isAwake(i);
+			tree.setStatic(proxies[i], !awake);
+			if(awake) tree.move(proxies[i], boxes[i]);
+		}
+		tree.updatePairs();
+	};
+	for(int i = 0; i < 10; i++) {
+		sweep();
+		islands.update(0.1f, [](const auto&) { return true; });
+	}
+	ASSERT_FALSE(islands.isAwake(0));
+	ASSERT_FALSE(islands.isAwake(1));
+	sweep();
+	EXPECT_TRUE(tree.getPairs().empty());
+
+	// woken from outside the step, as a key press does
+	islands.wake(0);
+	sweep();
+	PairSet found;
+	for(auto& [a, b]: tree.getPairs()) found.insert(ordered(a, b));
+	EXPECT_TRUE(found.count(ordered(&boxes[0], &wall)));
+	EXPECT_FALSE(found.count(ordered(&boxes[1], &wall)));
+}
+
+TEST(AABBTree, RemoveAndQuery)
+{
+	auto rects = makeRects(500, 640, 480, 5, 20);
+	phy::AABBTree<phy::Rect2D> tree;
+	tree.setMargin(0.0f);
+	std::vector<phy::AABBTree<phy::Rect2D>::index_type> proxies;
+	for(auto& r: rects) proxies.push_back(tree.insert(&r, r));
+
+	for(size_t i = 0; i < rects.size(); i += 2) tree.remove(proxies[i]);
+	EXPECT_EQ(tree.size(), rects.size() / 2);
+
+	const phy::Rect2D range{ { 100, 100 }, { 200, 150 } };
+	std::vector<phy::Rect2D*> queried;
+	tree.getRange(range, queried);
+
+	std::set<const phy::Rect2D*> found(queried.begin(), queried.end());
+	for(size_t i = 0; i < rects.size(); i++) {
+		if(i % 2 == 0) {
+			EXPECT_FALSE(found.count(&rects[i]));
+		} else if(overlaps(rects[i], range)) {
+			EXPECT_TRUE(found.count(&rects[i]));
+		}
+	}
+
+	// freed nodes are reused rather than growing the pool
+	const size_t nodes = tree.nodeCount();
+	for(size_t i = 0; i < rects.size(); i += 2) proxies[i] = tree.insert(&rects[i], rects[i]);
+	EXPECT_EQ(tree.nodeCount(), nodes);
+}
+
+TEST(AABBTree, RayCastFindsClosestHit)
+{
+	std::vector<phy::Rect2D> rects;
+	for(int i = 0; i < 20; i++) rects.push_back(phy::Rect2D{ { 50.0f + i * 30.0f, 95 }, { 10, 10 } });
+	rects.push_back(phy::Rect2D{ { 200, 300 }, { 10, 10 } });
+
+	phy::AABBTree<phy::Rect2D> tree;
+	tree.setMargin(0.0f);
+	for(auto& r: rects) tree.insert(&r, r);
+
+	const phy::vec2 from{ 700, 100 }, to{ 0, 100 };
+	phy::Rect2D* closest = nullptr;
+	int visited = 0;
+	tree.rayCast(from, to, [&](phy::Rect2D* r, const phy::vec2& p1, const phy::vec2& p2, const float& maxFraction) {
+		visited++;
+		// slab entry along x, the ray is horizontal
+		const float t = (p1.x - (r->pos.x + r->size.x)) / (p1.x - p2.x);
+		if(t >= maxFraction) return maxFraction;
+		closest = r;
+		return t;
+	});
+
+	ASSERT_NE(closest, nullptr);
+	EXPECT_EQ(closest, &rects[19]);
+	EXPECT_LE(visited, 20);
+}
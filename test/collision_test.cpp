@@ -0,0 +1,377 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+#include "../small/include/phy/polygonrb.h"
+#include "../small/include/phy/collision.h"
+#include "../small/include/phy/manifoldcache.h"
+#include "../small/include/phy/contactsolver.h"
+#include "../small/include/phy/islands.h"
+
+
+static phy::polygon makeBox(const float& w, const float& h)
+{
+	phy::polygon p;
+	p.vertices = { { -w/2, -h/2 }, { w/2, -h/2 }, { w/2, h/2 }, { -w/2, h/2 } };
+	return p;
+}
+
+static void expectMatchesRotate(phy::polygon& p)
+{
+	const auto& world = p.getWorldVertices();
+	ASSERT_EQ(world.size(), p.vertices.size());
+	for(size_t i = 0; i < world.size(); i++) {
+		const phy::vec2 expected = p.pos + p.vertices[i].rotate(p.getRotation());
+		EXPECT_NEAR(world[i].x, expected.x, 1e-4f);
+		EXPECT_NEAR(world[i].y, expected.y, 1e-4f);
+	}
+}
+
+
+TEST(Polygon, WorldVerticesFollowPosAndRotation)
+{
+	phy::polygon box = makeBox(20, 10);
+	box.pos = { 100, 50 };
+	expectMatchesRotate(box);
+
+	box.pos += phy::vec2{ 3, -2 };
+	expectMatchesRotate(box);
+
+	box.setRotation(0.3f);
+	expectMatchesRotate(box);
+
+	box.rotate(0.05f);
+	expectMatchesRotate(box);
+
+	box.rotor = phy::vec2::fromAngle(1.2f);
+	expectMatchesRotate(box);
+}
+
+TEST(Polygon, RotorStepsMatchAngleWithoutDeforming)
+{
+	// a long spin in small steps, plus a few large ones that take the cos/sin path
+	phy::polygon box = makeBox(20, 10);
+	const std::vector<phy::vec2> model = box.vertices;
+	double angle = 0;
+	for(int step = 0; step < 100000; step++) {
+		const float delta = step % 1000 == 0 ? 1.0f : 0.2f * std::sin(step * 0.001f);
+		box.rotate(delta);
+		angle += delta;
+	}
+
+	EXPECT_NEAR(std::hypot(box.rotor.x, box.rotor.y), 1.0f, 1e-6f);
+	EXPECT_NEAR(std::remainder(box.getRotation() - angle, 2 * 3.14159265358979), 0.0, 1e-3);
+	const auto& world = box.getWorldVertices();
+	for(size_t i = 0; i < world.size(); i++) {
+		EXPECT_EQ(box.vertices[i].x, model[i].x);
+		EXPECT_EQ(box.vertices[i].y, model[i].y);
+		auto edge = world[(i + 1) % world.size()] - world[i];
+		EXPECT_NEAR(edge.length(), i % 2 == 0 ? 20.0f : 10.0f, 1e-4f) << "edge " << i;
+	}
+}
+
+TEST(Polygon, EdgeNormalsAreUnitAndOutwardForBoxWinding)
+{
+	phy::polygon box = makeBox(20, 10);
+	box.pos = { 7, 9 };
+	box.setRotation(0.7f);
+
+	const auto& world = box.getWorldVertices();
+	const auto& normals = box.getEdgeNormals();
+	for(size_t i = 0; i < world.size(); i++) {
+		auto n = normals[i];
+		EXPECT_NEAR(n.length(), 1.0f, 1e-5f);
+		const phy::vec2 mid = (world[i] + world[(i + 1) % world.size()]) * 0.5f;
+		EXPECT_GT((mid - box.pos).dotProduct(n), 0.0f) << "edge " << i;
+	}
+}
+
+static std::vector<phy::vec2> boxAt(const phy::vec2& center, const float& w, const float& h, const float& angle = 0)
+{
+	phy::polygon box = makeBox(w, h);
+	box.pos = center;
+	box.setRotation(angle);
+	return box.getWorldVertices();
+}
+
+TEST(Collision, CircleToCircleSeparatesAndConservesMomentum)
+{
+	phy::vec2 p1{ 0, 0 }, v1{ 3, 1 }, p2{ 15, 0 }, v2{ -1, 2 };
+	const float m1 = 2, m2 = 5;
+	const phy::vec2 momentum = v1 * m1 + v2 * m2;
+	const float energy = m1 * v1.dotProduct(v1) + m2 * v2.dotProduct(v2);
+
+	ASSERT_TRUE(phy::collision::circleToCircle(p1, v1, 10, m1, p2, v2, 10, m2));
+	EXPECT_NEAR((p2 - p1).length(), 20.0f, 1e-4f);
+	const phy::vec2 after = v1 * m1 + v2 * m2;
+	EXPECT_NEAR(after.x, momentum.x, 1e-4f);
+	EXPECT_NEAR(after.y, momentum.y, 1e-4f);
+	EXPECT_NEAR(m1 * v1.dotProduct(v1) + m2 * v2.dotProduct(v2), energy, 1e-3f);
+	EXPECT_FLOAT_EQ(v1.y, 1.0f);	// tangential velocities untouched
+	EXPECT_FLOAT_EQ(v2.y, 2.0f);
+
+	EXPECT_FALSE(phy::collision::circleToCircle(p1, v1, 10, m1, p2, v2, 10, m2));
+}
+
+TEST(Collision, GjkSeparatedBoxesReportGap)
+{
+	const auto a = boxAt({ 0, 0 }, 2, 2), b = boxAt({ 5, 0.5f }, 2, 2);
+	phy::contactInfo contact;
+	EXPECT_FALSE(phy::collision::gjk({ a }, { b }, contact));
+	EXPECT_NEAR(contact.depth, -3.0f, 1e-4f);
+	EXPECT_NEAR(contact.normal.x, 1.0f, 1e-4f);
+	EXPECT_NEAR(contact.normal.y, 0.0f, 1e-4f);
+	EXPECT_NEAR(contact.pointA.x, 1.0f, 1e-4f);
+	EXPECT_NEAR(contact.pointB.x, 4.0f, 1e-4f);
+}
+
+TEST(Collision, EpaOverlappingBoxesGiveMinimumTranslation)
+{
+	const auto a = boxAt({ 0, 0 }, 2, 2), b = boxAt({ 1.5f, 0.2f }, 2, 2);
+	phy::contactInfo contact;
+	ASSERT_TRUE(phy::collision::gjk({ a }, { b }, contact));
+	EXPECT_NEAR(contact.depth, 0.5f, 1e-4f);
+	EXPECT_NEAR(contact.normal.x, 1.0f, 1e-4f);
+	EXPECT_NEAR(contact.normal.y, 0.0f, 1e-4f);
+	EXPECT_NEAR(contact.pointA.x - contact.pointB.x, 0.5f, 1e-4f);
+
+	// swapping the shapes flips the normal
+	ASSERT_TRUE(phy::collision::gjk({ b }, { a }, contact));
+	EXPECT_NEAR(contact.normal.x, -1.0f, 1e-4f);
+	EXPECT_NEAR(contact.depth, 0.5f, 1e-4f);
+}
+
+TEST(Collision, CirclesUseRadiusAsMargin)
+{
+	const phy::vec2 c1[] = { { 0, 0 } }, c2[] = { { 3, 4 } };
+	phy::contactInfo contact;
+
+	EXPECT_FALSE(phy::collision::gjk({ c1, 2 }, { c2, 2 }, contact));
+	EXPECT_NEAR(contact.depth, -1.0f, 1e-4f);
+
+	ASSERT_TRUE(phy::collision::gjk({ c1, 3 }, { c2, 3 }, contact));
+	EXPECT_NEAR(contact.depth, 1.0f, 1e-4f);
+	EXPECT_NEAR(contact.normal.x, 0.6f, 1e-4f);
+	EXPECT_NEAR(contact.normal.y, 0.8f, 1e-4f);
+	EXPECT_NEAR(contact.pointA.x, 1.8f, 1e-4f);
+	EXPECT_NEAR(contact.pointB.x, 1.2f, 1e-4f);
+
+	// circle resting on a box, centre inside the box's core
+	const auto box = boxAt({ 0, 10 }, 20, 2);
+	const phy::vec2 c3[] = { { 2, 8.5f } };
+	ASSERT_TRUE(phy::collision::gjk({ c3, 1 }, { box }, contact));
+	EXPECT_NEAR(contact.depth, 0.5f, 1e-4f);
+	EXPECT_NEAR(contact.normal.y, 1.0f, 1e-4f);
+}
+
+TEST(Collision, GjkAgreesWithSatOnRandomPolygons)
+{
+	// rotated boxes against each other: depth is the shortest push out along any SAT axis
+	auto satDepth = [](const std::vector<phy::vec2>& a, const std::vector<phy::vec2>& b) {
+		float best = INFINITY;
+		for(const auto* poly: { &a, &b }) {
+			for(size_t i = 0; i < poly->size(); i++) {
+				phy::vec2 n = ((*poly)[(i + 1) % poly->size()] - (*poly)[i]).perp(1);
+				float minA = INFINITY, maxA = -INFINITY, minB = INFINITY, maxB = -INFINITY;
+				for(auto p: a) { minA = std::min(minA, p.dotProduct(n)); maxA = std::max(maxA, p.dotProduct(n)); }
+				for(auto p: b) { minB = std::min(minB, p.dotProduct(n)); maxB = std::max(maxB, p.dotProduct(n)); }
+				best = std::min(best, std::min(maxA - minB, maxB - minA));
+			}
+		}
+		return best;
+	};
+
+	int overlaps = 0;
+	for(int i = 0; i < 200; i++) {
+		const float x = (i % 20) * 0.35f - 3.5f, angle = i * 0.37f;
+		const auto a = boxAt({ 0, 0 }, 4, 2, 0.2f), b = boxAt({ x, (i % 7) * 0.4f - 1.2f }, 3, 1.5f, angle);
+
+		phy::contactInfo contact;
+		const float sat = satDepth(a, b);
+		const bool hit = phy::collision::gjk({ a }, { b }, contact);
+		EXPECT_EQ(hit, sat > 0) << "case " << i;
+		if(sat > 1e-3f) {
+			overlaps++;
+			EXPECT_NEAR(contact.depth, sat, 1e-3f) << "case " << i;
+		}
+	}
+	EXPECT_GT(overlaps, 20);
+}
+
+TEST(Collision, BoxRestingOnBoxGetsTwoPoints)
+{
+	// b sits on top of a (y down), sunk 0.1 into it and shifted so one corner overhangs
+	const auto a = boxAt({ 0, 0 }, 4, 2), b = boxAt({ 1, -1.9f }, 2, 2);
+	phy::manifold m;
+	ASSERT_TRUE(phy::collision::polygonManifold(a, b, m));
+	ASSERT_EQ(m.count, 2);
+	EXPECT_NEAR(m.normal.x, 0.0f, 1e-5f);
+	EXPECT_NEAR(m.normal.y, -1.0f, 1e-5f);
+	EXPECT_NE(m.points[0].id, m.points[1].id);
+
+	float xs[2];
+	for(int i = 0; i < 2; i++) {
+		EXPECT_NEAR(m.points[i].depth, 0.1f, 1e-4f);
+		EXPECT_NEAR(m.points[i].point.y, -0.95f, 1e-4f);
+		xs[i] = m.points[i].point.x;
+	}
+	EXPECT_NEAR(std::min(xs[0], xs[1]), 0.0f, 1e-4f);
+	EXPECT_NEAR(std::max(xs[0], xs[1]), 2.0f, 1e-4f);
+
+	// swapping the shapes flips the normal but finds the same points
+	phy::manifold swapped;
+	ASSERT_TRUE(phy::collision::polygonManifold(b, a, swapped));
+	ASSERT_EQ(swapped.count, 2);
+	EXPECT_NEAR(swapped.normal.y, 1.0f, 1e-5f);
+
+	const auto apart = boxAt({ 1, -2.5f }, 2, 2);
+	EXPECT_FALSE(phy::collision::polygonManifold(a, apart, m));
+	EXPECT_EQ(m.count, 0);
+}
+
+TEST(Collision, ManifoldCacheCarriesImpulsesByFeature)
+{
+	const auto a = boxAt({ 0, 0 }, 4, 2);
+	phy::ManifoldCache cache;
+	phy::manifold m;
+
+	ASSERT_TRUE(phy::collision::polygonManifold(a, boxAt({ 1, -1.9f }, 2, 2), m));
+	phy::manifold& stored = cache.update(0, 1, m);
+	for(int i = 0; i < stored.count; i++) stored.points[i].normalImpulse = 1.0f + i;
+	const std::uint32_t firstId = stored.points[0].id;
+	cache.prune();
+
+	// the box slid and rotated a little: same features, so the impulses come back
+	ASSERT_TRUE(phy::collision::polygonManifold(a, boxAt({ 0.95f, -1.92f }, 2, 2, 0.01f), m));
+	ASSERT_EQ(m.count, 2);
+	EXPECT_EQ(m.points[0].normalImpulse, 0.0f);
+	const phy::manifold& warm = cache.update(0, 1, m);
+	for(int i = 0; i < warm.count; i++)
+		EXPECT_EQ(warm.points[i].normalImpulse, warm.points[i].id == firstId ? 1.0f : 2.0f);
+	cache.prune();
+	EXPECT_EQ(cache.size(), 1u);
+
+	// a pair that is not touched for a step goes away
+	cache.prune();
+	EXPECT_EQ(cache.size(), 0u);
+	EXPECT_EQ(cache.find(0, 1), nullptr);
+}
+
+TEST(Collision, SegmentActsAsTwoSidedWall)
+{
+	const phy::vec2 wall[] = { { -10, 0 }, { 10, 0 } };
+	phy::manifold m;
+	ASSERT_TRUE(phy::collision::polygonManifold(wall, boxAt({ 0, -0.8f }, 2, 2, 0.0f), m));
+	EXPECT_EQ(m.count, 2);
+	EXPECT_NEAR(m.normal.y, -1.0f, 1e-5f);
+	EXPECT_NEAR(m.points[0].depth, 0.2f, 1e-4f);
+
+	ASSERT_TRUE(phy::collision::polygonManifold(wall, boxAt({ 0, 0.8f }, 2, 2, 0.0f), m));
+	EXPECT_NEAR(m.normal.y, 1.0f, 1e-5f);
+}
+
+TEST(Solver, BoxStackSettlesAndStays)
+{
+	// ten unit boxes dropped in a column onto a static ground box, y down
+	const int count = 10;
+	const float dt = 1.0f / 60, g = 10;
+	std::vector<phy::polygon> boxes;
+	for(int i = 0; i < count; i++) {
+		boxes.push_back(makeBox(1, 1));
+		boxes.back().pos = { 0, -0.5f - i * 1.02f };
+	}
+	const auto ground = boxAt({ 0, 5 }, 40, 10);
+
+	phy::solverSettings settings;
+	settings.iterations = 10;
+	settings.slop = 0.005f;
+	phy::ContactSolver solver(settings);
+	phy::ManifoldCache cache;
+	std::vector<phy::solverBody> bodies(count + 1);
+	bodies[count].pos = { 0, 5 };
+
+	std::vector<phy::vec2> settled;
+	for(int step = 0; step < 600; step++) {
+		if(step == 300)
+			for(auto& box: boxes) settled.push_back(box.pos);
+
+		for(int i = 0; i < count; i++) {
+			auto& box = boxes[i];
+			box.vel += phy::vec2{ 0, g } * dt;
+			bodies[i] = { box.pos, box.vel, box.angVelo, 1, 6 };
+		}
+
+		phy::manifold m;
+		for(int i = 0; i < count; i++) {
+			if(phy::collision::polygonManifold(boxes[i].getWorldVertices(), ground, m))
+				solver.add(i, count, cache.update(i, count, m));
+			for(int j = i + 1; j < count; j++)
+				if(phy::collision::polygonManifold(boxes[i].getWorldVertices(), boxes[j].getWorldVertices(), m))
+					solver.add(i, j, cache.update(i, j, m));
+		}
+		cache.prune();
+		solver.solve(bodies, dt);
+
+		for(int i = 0; i < count; i++) {
+			auto& box = boxes[i];
+			box.vel = bodies[i].vel;
+			box.angVelo = bodies[i].angVelo;
+			box.pos += box.vel * dt;
+			box.rotate(box.angVelo * dt);
+		}
+	}
+
+	// upright where it landed, and not creeping once settled
+	for(int i = 0; i < count; i++) {
+		EXPECT_NEAR(boxes[i].pos.x, 0.0f, 0.05f) << "box " << i;
+		EXPECT_NEAR(boxes[i].pos.y, -0.5f - i, 0.05f) << "box " << i;
+		EXPECT_NEAR(boxes[i].pos.x, settled[i].x, 0.02f) << "box " << i;
+		EXPECT_NEAR(boxes[i].pos.y, settled[i].y, 0.02f) << "box " << i;
+		EXPECT_NEAR(boxes[i].getRotation(), 0.0f, 0.01f) << "box " << i;
+		EXPECT_LT(std::hypot(boxes[i].vel.x, boxes[i].vel.y), 0.05f) << "box " << i;
+	}
+}
+
+TEST(Islands, RestingIslandsSleepAndWakeTogether)
+{
+	// 0-1-2 touch each other, 3-4 touch, all of them rest on the static body 5
+	phy::Islands islands;
+	islands.resize(6);
+	islands.setStatic(5, true);
+	std::vector<bool> resting(6, true);
+	resting[4] = false;
+
+	auto step = [&] {
+		for(auto [a, b]: { std::pair{ 0, 1 }, std::pair{ 1, 2 }, std::pair{ 3, 4 }, std::pair{ 0, 5 }, std::pair{ 3, 5 } })
+			if(islands.isAwake(a) || islands.isAwake(b)) islands.addContact(a, b);
+		islands.update(0.1f, [&](const auto& i) { return resting[i]; });
+	};
+
+	for(int i = 0; i < 4; i++) step();
+	EXPECT_EQ(islands.getAwakeCount(), 5u);
+	step();
+	step();
+
+	// the floor does not link the islands, so 3 stays up with 4 still moving
+	for(int i = 0; i < 3; i++) EXPECT_FALSE(islands.isAwake(i)) << i;
+	EXPECT_TRUE(islands.isAwake(3));
+	EXPECT_TRUE(islands.isAwake(4));
+	EXPECT_FALSE(islands.isAwake(5));
+	EXPECT_EQ(islands.getAwakeCount(), 2u);
+
+	resting[4] = true;
+	for(int i = 0; i < 6; i++) step();
+	EXPECT_EQ(islands.getAwakeCount(), 0u);
+
+	// touching one body brings back its whole island and nothing else
+	islands.wake(1);
+	EXPECT_TRUE(islands.isAwake(0));
+	EXPECT_TRUE(islands.isAwake(1));
+	EXPECT_TRUE(islands.isAwake(2));
+	EXPECT_FALSE(islands.isAwake(3));
+	EXPECT_EQ(islands.getAwakeCount(), 3u);
+
+	// a contact from an awake body wakes a sleeping island
+	islands.addContact(2, 4);
+	EXPECT_EQ(islands.getAwakeCount(), 5u);
+}
@@ -0,0 +1,242 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+#include "../small/include/phy/vec2.h"
+#include "../small/include/phy/threadpool.h"
+#include "../small/include/phy/constraintgraph.h"
+#include "../small/include/phy/xpbd.h"
+#include "../small/include/phy/particlestore.h"
+
+
+using Edge = phy::ConstraintGraph::edge_type;
+
+// structural and shear sticks of a w x h cloth grid
+static std::vector<Edge> makeCloth(const int& w, const int& h)
+{
+	std::vector<Edge> edges;
+	auto id = [&](int x, int y) { return static_cast<phy::ConstraintGraph::index_type>(y * w + x); };
+	for(int y = 0; y < h; y++) {
+		for(int x = 0; x < w; x++) {
+			if(x + 1 < w) edges.push_back({ id(x, y), id(x + 1, y) });
+			if(y + 1 < h) edges.push_back({ id(x, y), id(x, y + 1) });
+			if(x + 1 < w && y + 1 < h) {
+				edges.push_back({ id(x, y), id(x + 1, y + 1) });
+				edges.push_back({ id(x + 1, y), id(x, y + 1) });
+			}
+		}
+	}
+	return edges;
+}
+
+
+TEST(ConstraintGraph, ColorsNeverShareAParticle)
+{
+	const int w = 60, h = 40;
+	const auto edges = makeCloth(w, h);
+	phy::ConstraintGraph graph;
+	graph.build(edges, w * h);
+
+	EXPECT_EQ(graph.size(), edges.size());
+	EXPECT_TRUE(graph.getOverflow().empty());
+	EXPECT_LE(graph.colorCount(), 16u);
+
+	std::vector<int> seen(edges.size(), 0);
+	for(size_t c = 0; c < graph.colorCount(); c++) {
+		std::vector<bool> touched(w * h, false);
+		for(auto i: graph.getColor(c)) {
+			seen[i]++;
+			EXPECT_FALSE(touched[edges[i].first]) << "color " << c;
+			EXPECT_FALSE(touched[edges[i].second]) << "color " << c;
+			touched[edges[i].first] = touched[edges[i].second] = true;
+		}
+	}
+	for(auto count: seen) EXPECT_EQ(count, 1);
+}
+
+TEST(ConstraintGraph, StarSpillsIntoSerialGroup)
+{
+	// particle 0 is in 100 constraints, more than there are colors
+	std::vector<Edge> edges;
+	for(phy::ConstraintGraph::index_type i = 1; i <= 100; i++) edges.push_back({ 0, i });
+	phy::ConstraintGraph graph;
+	graph.build(edges, 101);
+
+	EXPECT_EQ(graph.colorCount(), phy::ConstraintGraph::maxColors);
+	EXPECT_EQ(graph.getOverflow().size(), 100 - phy::ConstraintGraph::maxColors);
+
+	int calls = 0;
+	graph.solve([&](const auto&) { calls++; });
+	EXPECT_EQ(calls, 100);
+}
+
+TEST(ConstraintGraph, ParallelSolveMatchesSerial)
+{
+	// each color is race free, so spreading it over threads gives the same bits
+	const int w = 200, h = 100;
+	const auto edges = makeCloth(w, h);
+	phy::ConstraintGraph graph;
+	graph.build(edges, w * h);
+
+	auto relax = [&](std::vector<phy::vec2>& pos, phy::ThreadPool* pool) {
+		for(int iteration = 0; iteration < 5; iteration++) {
+			graph.solve([&](const auto& i) {
+				auto& a = pos[edges[i].first];
+				auto& b = pos[edges[i].second];
+				auto delta = b - a;
+				const float dist = delta.length();
+				if(dist == 0.0f) return;
+				const float diff = (dist - 1.0f) * 0.5f / dist;
+				a += delta * diff;
+				b -= delta * diff;
+			}, pool);
+		}
+	};
+
+	std::vector<phy::vec2> serial(w * h);
+	for(int i = 0; i < w * h; i++) serial[i] = { (i % w) * 1.3f, (i / w) * 0.8f + std::sin(i * 0.1f) };
+	std::vector<phy::vec2> parallel = serial;
+
+	phy::ThreadPool pool(4);
+	relax(serial, nullptr);
+	relax(parallel, &pool);
+	for(int i = 0; i < w * h; i++) {
+		ASSERT_EQ(serial[i].x, parallel[i].x) << i;
+		ASSERT_EQ(serial[i].y, parallel[i].y) << i;
+	}
+}
+
+// one particle hanging from a pinned one, integrated with symplectic Euler and damped
+static float hangingStretch(const float& compliance, const int& substeps)
+{
+	const float g = 10, dt = 1.0f / 60, h = dt / substeps;
+	std::vector<phy::vec2> pos{ { 0, 0 }, { 0, 1 } }, vel(2);
+	const std::vector<float> invMass{ 0, 1 };
+	phy::XPBDSolver solver;
+	solver.addDistance(0, 1, 1.0f, compliance);
+
+	for(int step = 0; step < 600; step++) {
+		for(int s = 0; s < substeps; s++) {
+			const phy::vec2 prev = pos[1];
+			vel[1] = (vel[1] + phy::vec2{ 0, g } * h) * 0.995f;
+			pos[1] += vel[1] * h;
+			solver.solve(pos, invMass, h);
+			vel[1] = (pos[1] - prev) * (1 / h);
+		}
+	}
+	return pos[1].y - 1.0f;
+}
+
+TEST(XPBD, StretchFollowsComplianceNotSubsteps)
+{
+	// at rest the stick pulls back m * g: stretch = compliance * m * g
+	for(int substeps: { 1, 4, 16 }) {
+		EXPECT_NEAR(hangingStretch(0.01f, substeps), 0.1f, 2e-3f) << substeps;
+		EXPECT_NEAR(hangingStretch(0.0f, substeps), 0.0f, 1e-4f) << substeps;
+	}
+}
+
+TEST(XPBD, BendingAndAreaReturnToRest)
+{
+	// a square with rigid sides, a hinge angle at 1 and its area, squashed and released
+	std::vector<phy::vec2> pos{ { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+	const std::vector<float> invMass(4, 1.0f);
+	const std::vector<phy::XPBDSolver::index_type> loop{ 0, 1, 2, 3 };
+
+	phy::XPBDSolver solver;
+	solver.iterations = 4;
+	for(phy::XPBDSolver::index_type i = 0; i < 4; i++) solver.addDistance(i, (i + 1) % 4, 1.0f);
+	const float restAngle = phy::XPBDSolver::angle(pos, 0, 1, 2);
+	solver.addBending(0, 1, 2, restAngle);
+	solver.addArea(loop, phy::XPBDSolver::area(pos, loop));
+
+	pos[2] = { 1.4f, 0.8f };
+	pos[3] = { 0.4f, 0.8f };
+	for(int step = 0; step < 20; step++) solver.solve(pos, invMass, 1.0f / 60);
+
+	EXPECT_NEAR(phy::XPBDSolver::angle(pos, 0, 1, 2), restAngle, 1e-3f);
+	EXPECT_NEAR(phy::XPBDSolver::area(pos, loop), 1.0f, 1e-3f);
+	for(int i = 0; i < 4; i++) {
+		auto side = pos[(i + 1) % 4] - pos[i];
+		EXPECT_NEAR(side.length(), 1.0f, 1e-3f) << i;
+	}
+}
+
+TEST(ParticleStore, MatchesScalarVerlet)
+{
+	// the vectorized passes against a per-particle reference, pinned particle included
+	struct Reference { phy::vec2 pos, prev; float invMass, radius; };
+	const float left = 0, right = 100, bottom = 80, damping = 0.98f, friction = 0.85f;
+	const phy::vec2 gravity{ 0, 50 };
+
+	phy::ParticleStore store;
+	std::vector<Reference> reference;
+	for(int i = 0; i < 37; i++) {
+		const phy::vec2 pos{ float(i * 7 % 110) - 5, float(i * 13 % 90) };
+		const float mass = i % 5 == 0 ? 0.0f : 1.0f;
+		store.add(pos, 3, mass);
+		store.prevX[i] = pos.x - float(i % 3);
+		reference.push_back({ pos, { pos.x - float(i % 3), pos.y }, mass > 0 ? 1.0f : 0.0f, 3 });
+	}
+
+	for(int step = 0; step < 120; step++) {
+		store.integrate(1.0f / 60, gravity, damping);
+		store.constrainToBox(left, right, bottom, damping, friction);
+
+		for(auto& p: reference) {
+			if(p.invMass > 0) {
+				const phy::vec2 current = p.pos;
+				p.pos += (p.pos - p.prev) * damping + gravity * (1.0f / 3600);
+				p.prev = current;
+			} else {
+				p.prev = p.pos;
+			}
+
+			const phy::vec2 vel = (p.pos - p.prev) * damping;
+			if(p.pos.y + p.radius > bottom) {
+				p.pos.y = bottom - p.radius;
+				p.prev.y = p.pos.y + vel.y * friction;
+			}
+			if(p.pos.x - p.radius < left) {
+				p.pos.x = left + p.radius;
+				p.prev.x = p.pos.x + vel.x * friction;
+			} else if(p.pos.x + p.radius > right) {
+				p.pos.x = right - p.radius;
+				p.prev.x = p.pos.x + vel.x * friction;
+			}
+		}
+	}
+
+	for(size_t i = 0; i < reference.size(); i++) {
+		EXPECT_NEAR(store.x[i], reference[i].pos.x, 1e-3f) << i;
+		EXPECT_NEAR(store.y[i], reference[i].pos.y, 1e-3f) << i;
+		EXPECT_NEAR(store.prevX[i], reference[i].prev.x, 1e-3f) << i;
+		EXPECT_NEAR(store.prevY[i], reference[i].prev.y, 1e-3f) << i;
+	}
+}
+
+TEST(XPBD, SplitArraysMatchVec2)
+{
+	std::vector<phy::vec2> pos{ { 0, 0 }, { 1.2f, 0 }, { 1, 1.3f }, { -0.1f, 0.9f } };
+	std::vector<float> x, y;
+	for(auto& p: pos) { x.push_back(p.x); y.push_back(p.y); }
+	const std::vector<float> invMass{ 0, 1, 1, 1 };
+	const std::vector<phy::XPBDSolver::index_type> loop{ 0, 1, 2, 3 };
+
+	phy::XPBDSolver a, b;
+	for(auto* solver: { &a, &b }) {
+		for(phy::XPBDSolver::index_type i = 0; i < 4; i++) solver->addDistance(i, (i + 1) % 4, 1.0f, 1e-4f);
+		solver->addBending(0, 1, 2, 1.5f);
+		solver->addArea(loop, 1.0f);
+	}
+
+	for(int step = 0; step < 10; step++) {
+		a.solve(pos, invMass, 1.0f / 60);
+		b.solve(x, y, invMass, 1.0f / 60);
+	}
+	EXPECT_EQ(phy::XPBDSolver::area(pos, loop), phy::XPBDSolver::area(x, y, loop));
+	for(size_t i = 0; i < pos.size(); i++) {
+		EXPECT_EQ(pos[i].x, x[i]) << i;
+		EXPECT_EQ(pos[i].y, y[i]) << i;
+	}
+}
@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#define PHY_PROFILE
+#include "../small/include/phy/profiler.h"
+
+
+TEST(Profiler, ZonesSumPerNameAcrossThreads)
+{
+	phy::Profiler::clear();
+	auto work = [] {
+		for(int i = 0; i < 100; i++) {
+			PHY_ZONE("step");
+			PHY_ZONE("inner");
+		}
+	};
+	work();
+	std::thread other(work);
+	other.join();
+
+	const auto totals = phy::Profiler::totals();
+	ASSERT_EQ(totals.size(), 2u);
+	EXPECT_EQ(std::get<0>(totals[0]), "inner");	// closes first, so is seen first
+	EXPECT_EQ(std::get<0>(totals[1]), "step");
+	EXPECT_EQ(std::get<2>(totals[0]), 200u);
+	EXPECT_EQ(std::get<2>(totals[1]), 200u);
+	EXPECT_GE(std::get<1>(totals[1]), std::get<1>(totals[0]));
+}
+
+TEST(Profiler, ChromeTraceKeepsNewestZones)
+{
+	phy::Profiler::clear();
+	for(size_t i = 0; i < phy::Profiler::capacity + 10; i++) {
+		PHY_ZONE("tick");
+	}
+	{
+		PHY_ZONE("last \"one\"");
+	}
+
+	const std::string path = ::testing::TempDir() + "profiler_test.trace.json";
+	ASSERT_TRUE(phy::Profiler::writeChromeTrace(path));
+	std::ifstream file(path);
+	std::stringstream text;
+	text << file.rdbuf();
+	const std::string json = text.str();
+
+	size_t events = 0;
+	for(size_t at = json.find("\"ph\":\"X\""); at != std::string::npos; at = json.find("\"ph\":\"X\"", at + 1)) events++;
+	EXPECT_EQ(events, phy::Profiler::capacity);
+	EXPECT_EQ(json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0), 0u);
+	EXPECT_NE(json.find("\"name\":\"last \\\"one\\\"\""), std::string::npos);
+	EXPECT_EQ(json.substr(json.size() - 4), "\n]}\n");
+}
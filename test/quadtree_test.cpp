@@ -0,0 +1,412 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "../small/include/phy/quadtree.h"
+#include "../small/include/phy/linearquadtree.h"
+
+
+static std::vector<phy::Rect2D> makeRects(const int& count, const float& w, const float& h, const unsigned& seed = 7)
+{
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<float> px(0.0f, w - 30.0f), py(0.0f, h - 30.0f), sz(2.0f, 30.0f);
+
+	std::vector<phy::Rect2D> rects;
+	for(int i = 0; i < count; i++)
+		rects.push_back(phy::Rect2D{ { px(gen), py(gen) }, { sz(gen), sz(gen) } });
+	return rects;
+}
+
+static bool overlaps(const phy::Rect2D& a, const phy::Rect2D& b)
+{
+	return a.pos.x < b.pos.x + b.size.x && a.pos.x + a.size.x > b.pos.x &&
+		a.pos.y < b.pos.y + b.size.y && a.pos.y + a.size.y > b.pos.y;
+}
+
+
+TEST(Quadtree, RangeMatchesBruteForce)
+{
+	auto rects = makeRects(2000, 1024, 640);
+	phy::Quadtree<phy::Rect2D> qtree;
+	qtree.resize(phy::Rect2D{ { 0, 0 }, { 1024, 640 } }, 4, 100);
+	for(auto& r: rects) ASSERT_TRUE(qtree.insert(&r));
+	EXPECT_EQ(qtree.size(), rects.size());
+	EXPECT_GT(qtree.nodeCount(), 1u);
+
+	phy::Rect2D range{ { 300, 200 }, { 200, 150 } };
+	std::vector<phy::Rect2D*> queried;
+	qtree.getRange(range, queried);
+
+	std::vector<phy::Rect2D*> expected;
+	for(auto& r: rects) if(overlaps(r, range)) expected.push_back(&r);
+
+	std::sort(queried.begin(), queried.end());
+	std::sort(expected.begin(), expected.end());
+	EXPECT_EQ(queried, expected);
+}
+
+TEST(Quadtree, RejectsObjectOutsideBoundary)
+{
+	phy::Quadtree<phy::Rect2D> qtree;
+	qtree.resize(phy::Rect2D{ { 0, 0 }, { 100, 100 } }, 4);
+	phy::Rect2D outside{ { 90, 90 }, { 20, 20 } };
+	EXPECT_FALSE(qtree.insert(&outside));
+}
+
+TEST(Quadtree, RebuildReusesPools)
+{
+	auto rects = makeRects(5000, 1024, 640);
+	phy::Quadtree<phy::Rect2D> qtree;
+
+	qtree.resize(phy::Rect2D{ { 0, 0 }, { 1024, 640 } }, 4, 100);
+	for(auto& r: rects) qtree.insert(&r);
+	const auto nodes = qtree.nodeCount();
+
+	for(int frame = 0; frame < 3; frame++) {
+		qtree.resize(phy::Rect2D{ { 0, 0 }, { 1024, 640 } }, 4, 100);
+		for(auto& r: rects) qtree.insert(&r);
+		EXPECT_EQ(qtree.nodeCount(), nodes);
+		EXPECT_EQ(qtree.size(), rects.size());
+	}
+}
+
+TEST(Quadtree, UpdateRelocatesMovedObjects)
+{
+	auto rects = makeRects(3000, 1024, 640);
+	phy::Quadtree<phy::Rect2D> qtree;
+	qtree.resize(phy::Rect2D{ { 0, 0 }, { 1024, 640 } }, 4, 100);
+	for(auto& r: rects) qtree.insert(&r);
+
+	std::mt19937 gen(3);
+	std::uniform_real_distribution<float> step(-40.0f, 40.0f);
+	for(int frame = 0; frame < 20; frame++) {
+		for(size_t i = 0; i < rects.size(); i += 3) {
+			auto& r = rects[i];
+			r.pos.x = std::clamp(r.pos.x + step(gen), 0.0f, 1024.0f - r.size.x);
+			r.pos.y = std::clamp(r.pos.y + step(gen), 0.0f, 640.0f - r.size.y);
+			ASSERT_TRUE(qtree.update(&r));
+		}
+		qtree.merge();
+	}
+	EXPECT_EQ(qtree.size(), rects.size());
+
+	phy::Rect2D range{ { 100, 100 }, { 400, 300 } };
+	std::vector<phy::Rect2D*> queried, expected;
+	qtree.getRange(range, queried);
+	for(auto& r: rects) if(overlaps(r, range)) expected.push_back(&r);
+
+	std::sort(queried.begin(), queried.end());
+	std::sort(expected.begin(), expected.end());
+	EXPECT_EQ(queried, expected);
+}
+
+TEST(Quadtree, RemoveAndMergeCollapsesEmptyTree)
+{
+	auto rects = makeRects(500, 1024, 640);
+	phy::Quadtree<phy::Rect2D> qtree;
+	qtree.resize(phy::Rect2D{ { 0, 0 }, { 1024, 640 } }, 4, 100);
+	for(auto& r: rects) qtree.insert(&r);
+	ASSERT_FALSE(qtree.getChildren().empty());
+
+	for(size_t i = 0; i < rects.size(); i++) {
+		ASSERT_TRUE(qtree.remove(&rects[i]));
+		EXPECT_FALSE(qtree.remove(&rects[i]));
+	}
+	qtree.merge();
+
+	EXPECT_EQ(qtree.size(), 0u);
+	EXPECT_TRUE(qtree.getChildren().empty());
+
+	std::vector<phy::Rect2D*> queried;
+	qtree.getRange(qtree.getBoundary(), queried);
+	EXPECT_TRUE(queried.empty());
+}
+
+TEST(Quadtree, UpdateDropsObjectLeavingRoot)
+{
+	phy::Quadtree<phy::Rect2D> qtree;
+	qtree.resize(phy::Rect2D{ { 0, 0 }, { 100, 100 } }, 4);
+	phy::Rect2D r{ { 10, 10 }, { 5, 5 } };
+	ASSERT_TRUE(qtree.insert(&r));
+	r.pos.x = 200;
+	EXPECT_FALSE(qtree.update(&r));
+	EXPECT_EQ(qtree.size(), 0u);
+}
+
+TEST(Quadtree, LooseModeKeepsStraddlersOutOfRoot)
+{
+	auto rects = makeRects(3000, 1024, 640);
+	phy::Quadtree<phy::Rect2D> strict, loose;
+	strict.resize(phy::Rect2D{ { 0, 0 }, { 1024, 640 } }, 4, 100);
+	loose.resize(phy::Rect2D{ { 0, 0 }, { 1024, 640 } }, 4, 100, 2.0f);
+	for(auto& r: rects) {
+		ASSERT_TRUE(strict.insert(&r));
+		ASSERT_TRUE(loose.insert(&r));
+	}
+
+	EXPECT_TRUE(loose.isLoose());
+	EXPECT_LT(loose.getRoot().objectCount, strict.getRoot().objectCount);
+	EXPECT_EQ(loose.getRoot().objectCount, 0u);
+
+	std::mt19937 gen(11);
+	std::uniform_real_distribution<float> step(-25.0f, 25.0f);
+	for(int frame = 0; frame < 10; frame++) {
+		for(auto& r: rects) {
+			r.pos.x = std::clamp(r.pos.x + step(gen), 0.0f, 1024.0f - r.size.x);
+			r.pos.y = std::clamp(r.pos.y + step(gen), 0.0f, 640.0f - r.size.y);
+			ASSERT_TRUE(loose.update(&r));
+		}
+		loose.merge();
+	}
+
+	for(const auto& range: { phy::Rect2D{ { 500, 300 }, { 60, 60 } }, phy::Rect2D{ { 0, 0 }, { 1024, 640 } } }) {
+		std::vector<phy::Rect2D*> queried, expected;
+		loose.getRange(range, queried);
+		for(auto& r: rects) if(overlaps(r, range)) expected.push_back(&r);
+
+		std::sort(queried.begin(), queried.end());
+		std::sort(expected.begin(), expected.end());
+		EXPECT_EQ(queried, expected);
+	}
+
+	// a slightly loose root: whatever is accepted must still be found where it overhangs
+	phy::Quadtree<phy::Rect2D> tight;
+	tight.resize(phy::Rect2D{ { 0, 0 }, { 100, 100 } }, 4, 100, 1.2f);
+	phy::Rect2D tooBig{ { 68, 20 }, { 60, 60 } }, overhang{ { 90, 40 }, { 18, 18 } };
+	EXPECT_FALSE(tight.insert(&tooBig));
+	ASSERT_TRUE(tight.insert(&overhang));
+	std::vector<phy::Rect2D*> queried;
+	tight.getRange(phy::Rect2D{ { 105, 45 }, { 2, 2 } }, queried);
+	EXPECT_EQ(queried, std::vector<phy::Rect2D*>{ &overhang });
+}
+
+TEST(Quadtree, VisitorAndSpanQueriesMatchGetRange)
+{
+	auto rects = makeRects(4000, 1024, 640);
+	phy::Quadtree<phy::Rect2D> qtree;
+	qtree.resize(phy::Rect2D{ { 0, 0 }, { 1024, 640 } }, 4, 50);
+	for(auto& r: rects) qtree.insert(&r);
+
+	phy::Rect2D range{ { 200, 150 }, { 300, 200 } };
+	std::vector<phy::Rect2D*> expected, visited;
+	qtree.getRange(range, expected);
+	qtree.query(range, [&](phy::Rect2D* r) { visited.push_back(r); });
+	EXPECT_EQ(visited, expected);
+
+	std::vector<phy::Rect2D*> buffer(expected.size());
+	EXPECT_EQ(qtree.getRange(range, std::span<phy::Rect2D*>(buffer)), expected.size());
+	EXPECT_EQ(buffer, expected);
+
+	std::array<phy::Rect2D*, 4> small;
+	EXPECT_EQ(qtree.getRange(range, std::span<phy::Rect2D*>(small)), expected.size());
+
+	int seen = 0;
+	qtree.query(range, [&](phy::Rect2D*) { return ++seen < 3; });
+	EXPECT_EQ(seen, 3);
+}
+
+TEST(Quadtree, BulkBuildMatchesBruteForceSerialAndParallel)
+{
+	phy::ThreadPool pool(4);
+	for(const float looseness: { 1.0f, 2.0f }) {
+		auto rects = makeRects(30000, 1024, 640);
+		std::vector<phy::Rect2D*> pointers;
+		for(auto& r: rects) pointers.push_back(&r);
+
+		phy::Quadtree<phy::Rect2D> serial, parallel;
+		serial.resize(phy::Rect2D{ { 0, 0 }, { 1024, 640 } }, 8, 20, looseness);
+		parallel.resize(phy::Rect2D{ { 0, 0 }, { 1024, 640 } }, 8, 20, looseness);
+		serial.build(pointers);
+		parallel.build(pointers, &pool);
+
+		EXPECT_EQ(serial.size(), rects.size());
+		EXPECT_EQ(parallel.size(), rects.size());
+		EXPECT_EQ(parallel.nodeCount(), serial.nodeCount());
+
+		for(const phy::Rect2D range: { phy::Rect2D{ { 300, 200 }, { 200, 150 } }, phy::Rect2D{ { 500, 300 }, { 40, 40 } }, phy::Rect2D{ { 0, 0 }, { 1024, 640 } } }) {
+			std::vector<phy::Rect2D*> expected, fromSerial, fromParallel;
+			for(auto& r: rects) if(overlaps(r, range)) expected.push_back(&r);
+			serial.getRange(range, fromSerial);
+			parallel.getRange(range, fromParallel);
+
+			std::sort(expected.begin(), expected.end());
+			std::sort(fromSerial.begin(), fromSerial.end());
+			std::sort(fromParallel.begin(), fromParallel.end());
+			EXPECT_EQ(fromSerial, expected);
+			EXPECT_EQ(fromParallel, expected);
+		}
+
+		// a built tree still takes incremental edits
+		rects[0].pos = { 900, 600 };
+		EXPECT_TRUE(parallel.update(&rects[0]));
+		EXPECT_TRUE(parallel.remove(&rects[1]));
+		parallel.merge();
+		EXPECT_EQ(parallel.size(), rects.size() - 1);
+
+		std::vector<phy::Rect2D*> queried;
+		parallel.getRange(phy::Rect2D{ { 899, 599 }, { 2, 2 } }, queried);
+		EXPECT_NE(std::find(queried.begin(), queried.end(), &rects[0]), queried.end());
+	}
+}
+
+TEST(LinearQuadtree, RangeMatchesBruteForce)
+{
+	auto rects = makeRects(20000, 1024, 640);
+	std::mt19937 gen(11);
+	std::uniform_real_distribution<float> px(-50.0f, 1024.0f), py(-50.0f, 640.0f), sz(0.0f, 300.0f);
+
+	for(const int capacity: { 1, 4, 64 }) {
+		phy::LinearQuadtree<phy::Rect2D> tree;
+		tree.resize(phy::Rect2D{ { 0, 0 }, { 1024, 640 } }, capacity, 20);
+		for(auto& r: rects) ASSERT_TRUE(tree.insert(&r));
+		EXPECT_EQ(tree.size(), rects.size());
+
+		for(int i = 0; i < 50; i++) {
+			const phy::Rect2D range{ { px(gen), py(gen) }, { sz(gen), sz(gen) } };
+			std::vector<phy::Rect2D*> queried, expected;
+			tree.getRange(range, queried);
+			for(auto& r: rects) if(overlaps(r, range)) expected.push_back(&r);
+
+			std::sort(queried.begin(), queried.end());
+			std::sort(expected.begin(), expected.end());
+			ASSERT_EQ(queried, expected) << "capacity " << capacity << " query " << i;
+		}
+	}
+}
+
+TEST(LinearQuadtree, BuildRejectsOutsideAndVisitorStops)
+{
+	auto rects = makeRects(500, 1024, 640);
+	rects.push_back(phy::Rect2D{ { 1000, 600 }, { 50, 50 } });
+	std::vector<phy::Rect2D*> pointers;
+	for(auto& r: rects) pointers.push_back(&r);
+
+	phy::LinearQuadtree<phy::Rect2D> tree;
+	tree.resize(phy::Rect2D{ { 0, 0 }, { 1024, 640 } }, 4, 100);
+	tree.build(pointers);
+	EXPECT_EQ(tree.size(), rects.size() - 1);
+
+	int visited = 0;
+	tree.query(tree.getBoundary(), [&](phy::Rect2D*) { return ++visited < 3; });
+	EXPECT_EQ(visited, 3);
+
+	std::array<phy::Rect2D*, 8> out;
+	EXPECT_EQ(tree.getRange(tree.getBoundary(), std::span<phy::Rect2D*>(out)), rects.size() - 1);
+}
+
+static float boxDistance(const phy::vec2& p, const phy::Rect2D& r)
+{
+	const float dx = std::max({ r.pos.x - p.x, 0.0f, p.x - (r.pos.x + r.size.x) });
+	const float dy = std::max({ r.pos.y - p.y, 0.0f, p.y - (r.pos.y + r.size.y) });
+	return std::sqrt(dx * dx + dy * dy);
+}
+
+TEST(Quadtree, RadiusAndNearestMatchBruteForce)
+{
+	auto rects = makeRects(5000, 1024, 640);
+	std::mt19937 gen(13);
+	std::uniform_real_distribution<float> px(0.0f, 1024.0f), py(0.0f, 640.0f), radius(0.0f, 120.0f);
+
+	for(const float looseness: { 1.0f, 2.0f }) {
+		phy::Quadtree<phy::Rect2D> qtree;
+		qtree.resize(phy::Rect2D{ { 0, 0 }, { 1024, 640 } }, 4, 100, looseness);
+		for(auto& r: rects) ASSERT_TRUE(qtree.insert(&r));
+
+		for(int i = 0; i < 40; i++) {
+			const phy::vec2 p{ px(gen), py(gen) };
+			const float r = radius(gen);
+
+			std::vector<phy::Rect2D*> inRadius, expected;
+			qtree.queryRadius(p, r, [&](phy::Rect2D* object) { inRadius.push_back(object); });
+			for(auto& rect: rects) if(boxDistance(p, rect) <= r) expected.push_back(&rect);
+			std::sort(inRadius.begin(), inRadius.end());
+			std::sort(expected.begin(), expected.end());
+			ASSERT_EQ(inRadius, expected);
+
+			const size_t k = 1 + i % 17;
+			std::vector<phy::Rect2D*> nearest;
+			qtree.queryKNearest(p, k, nearest);
+			ASSERT_EQ(nearest.size(), k);
+
+			std::vector<float> distances, expectedDistances;
+			for(auto* object: nearest) distances.push_back(boxDistance(p, *object));
+			for(auto& rect: rects) expectedDistances.push_back(boxDistance(p, rect));
+			std::sort(expectedDistances.begin(), expectedDistances.end());
+			expectedDistances.resize(k);
+			EXPECT_EQ(distances, expectedDistances) << "nearest first, same distances as brute force";
+		}
+	}
+
+	phy::Quadtree<phy::Rect2D> small;
+	small.resize(phy::Rect2D{ { 0, 0 }, { 1024, 640 } }, 4);
+	for(int i = 0; i < 3; i++) small.insert(&rects[i]);
+	std::vector<phy::Rect2D*> nearest;
+	small.queryKNearest({ 10, 10 }, 10, nearest);
+	EXPECT_EQ(nearest.size(), 3u);
+}
+
+// entry t of a ray into a box by brute force, INFINITY on a miss
+static float rayEntry(const phy::Ray2D& ray, const phy::Rect2D& r)
+{
+	float tMin = 0, tMax = ray.maxT;
+	const float o[2] = { ray.origin.x, ray.origin.y }, d[2] = { ray.dir.x, ray.dir.y };
+	const float lo[2] = { r.pos.x, r.pos.y }, hi[2] = { r.pos.x + r.size.x, r.pos.y + r.size.y };
+	for(int a = 0; a < 2; a++) {
+		if(d[a] == 0) {
+			if(o[a] < lo[a] || o[a] > hi[a]) return INFINITY;
+			continue;
+		}
+		const float t0 = (lo[a] - o[a]) / d[a], t1 = (hi[a] - o[a]) / d[a];
+		tMin = std::max(tMin, std::min(t0, t1));
+		tMax = std::min(tMax, std::max(t0, t1));
+	}
+	return tMin <= tMax && tMin < ray.maxT ? tMin : INFINITY;
+}
+
+TEST(Quadtree, BatchedRaycastFindsFirstHit)
+{
+	auto rects = makeRects(3000, 1024, 640);
+	std::mt19937 gen(17);
+	std::uniform_real_distribution<float> px(-100.0f, 1124.0f), py(-100.0f, 740.0f), angle(0.0f, 6.2831853f), len(10.0f, 800.0f);
+
+	std::vector<phy::Ray2D> rays;
+	for(int i = 0; i < 300; i++) {
+		const float a = angle(gen);
+		rays.push_back(phy::Ray2D{ { px(gen), py(gen) }, { std::cos(a), std::sin(a) }, len(gen) });
+	}
+	rays.push_back(phy::Ray2D{ { 512, -50 }, { 0, 1 } });
+	rays.push_back(phy::Ray2D{ { -50, 320 }, { 1, 0 } });
+
+	for(const float looseness: { 1.0f, 2.0f }) {
+		phy::Quadtree<phy::Rect2D> qtree;
+		qtree.resize(phy::Rect2D{ { 0, 0 }, { 1024, 640 } }, 4, 100, looseness);
+		for(auto& r: rects) ASSERT_TRUE(qtree.insert(&r));
+
+		std::vector<phy::Quadtree<phy::Rect2D>::RayHit> hits(rays.size());
+		const size_t count = qtree.raycast(rays, hits);
+
+		size_t expectedCount = 0;
+		for(size_t i = 0; i < rays.size(); i++) {
+			float best = INFINITY;
+			for(auto& r: rects) best = std::min(best, rayEntry(rays[i], r));
+
+			if(best == INFINITY) {
+				EXPECT_EQ(hits[i].object, nullptr) << "ray " << i;
+				continue;
+			}
+			expectedCount++;
+			ASSERT_NE(hits[i].object, nullptr) << "ray " << i;
+			EXPECT_NEAR(hits[i].t, best, 1e-3f) << "ray " << i;
+			EXPECT_NEAR(rayEntry(rays[i], *hits[i].object), best, 1e-3f);
+
+			// the normal faces back along the ray unless it started inside the box
+			if(hits[i].t > 0) {
+				EXPECT_LT(hits[i].normal.x * rays[i].dir.x + hits[i].normal.y * rays[i].dir.y, 0.0f);
+			}
+		}
+		EXPECT_EQ(count, expectedCount);
+		EXPECT_GT(count, 0u);
+	}
+}
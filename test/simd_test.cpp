@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "../small/include/phy/vec2.h"
+#include "../small/include/phy/simd.h"
+
+
+// sizes around the register width, so both the batch loop and the tail run
+static const size_t sizes[] = { 0, 1, 3, 4, 7, 8, 9, 17, 33 };
+
+static void fill(std::vector<float>& x, std::vector<float>& y, const size_t& n)
+{
+	x.resize(n);
+	y.resize(n);
+	for(size_t i = 0; i < n; i++) {
+		x[i] = std::sin(float(i) * 1.7f) * 10;
+		y[i] = std::cos(float(i) * 0.3f) * 5 - 1;
+	}
+	if(n > 2) x[2] = y[2] = 0;	// a zero vector
+}
+
+TEST(Simd, ArithmeticMatchesVec2)
+{
+	for(const size_t& n: sizes) {
+		std::vector<float> ax, ay, bx, by, dots(n), crosses(n), lengths(n);
+		fill(ax, ay, n);
+		fill(bx, by, n);
+		std::reverse(bx.begin(), bx.end());
+
+		phy::simd::dot(ax, ay, bx, by, dots);
+		phy::simd::cross(ax, ay, bx, by, crosses);
+		phy::simd::length(ax, ay, lengths);
+
+		std::vector<float> sx = ax, sy = ay;
+		phy::simd::add(sx, sy, bx, by);
+		phy::simd::scale(sx, sy, 0.5f);
+
+		for(size_t i = 0; i < n; i++) {
+			phy::vec2 a{ ax[i], ay[i] }, b{ bx[i], by[i] };
+			EXPECT_FLOAT_EQ(dots[i], a.dotProduct(b)) << n << " " << i;
+			EXPECT_FLOAT_EQ(crosses[i], a.crossProduct(b)) << n << " " << i;
+			EXPECT_FLOAT_EQ(lengths[i], a.length()) << n << " " << i;
+			EXPECT_FLOAT_EQ(sx[i], (a + b).x * 0.5f) << n << " " << i;
+			EXPECT_FLOAT_EQ(sy[i], (a + b).y * 0.5f) << n << " " << i;
+		}
+	}
+}
+
+TEST(Simd, RotateNormalizePerpMatchVec2)
+{
+	for(const size_t& n: sizes) {
+		std::vector<float> x, y;
+		fill(x, y, n);
+
+		std::vector<float> rx = x, ry = y, nx = x, ny = y, px = x, py = y;
+		phy::simd::rotate(rx, ry, 0.7f);
+		phy::simd::normalize(nx, ny);
+		phy::simd::perp(px, py, 2.0f);
+
+		for(size_t i = 0; i < n; i++) {
+			phy::vec2 v{ x[i], y[i] };
+			const phy::vec2 r = v.rotate(0.7f), u = v.normalize(), p = v.perp(2.0f);
+			EXPECT_NEAR(rx[i], r.x, 1e-5f) << n << " " << i;
+			EXPECT_NEAR(ry[i], r.y, 1e-5f) << n << " " << i;
+			EXPECT_NEAR(nx[i], u.x, 1e-5f) << n << " " << i;
+			EXPECT_NEAR(ny[i], u.y, 1e-5f) << n << " " << i;
+			EXPECT_NEAR(px[i], p.x, 2e-5f) << n << " " << i;
+			EXPECT_NEAR(py[i], p.y, 2e-5f) << n << " " << i;
+		}
+	}
+}